@@ -3,6 +3,7 @@
 #include <string_view>
 
 #include "xdk/flags/flags.h"
+#include "xdk/flags/flags_stream.h"
 
 namespace {
 constexpr std::string_view kHelp = R"(
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+"""Measures the compile-time and binary-size cost of the flags headers.
+
+Compiles translation units that define and parse flags, and reports for each
+the compilation time (best of several runs), the object and `.text` sizes, the
+number of functions of namespace `xdk` instantiated, whether the object
+registers a static `std::ios_base::Init`, and which of `<istream>`,
+`<ostream>` and `<sstream>` the preprocessor includes. Besides fixed cases
+comparing the headers, translation units with 10, 100 and 1000 flags are
+generated. Instantiations are counted as the functions of namespace `xdk`
+defined in a separate `-O0` object, where none is inlined away, so that they
+grow with the types of the flags rather than with what the optimizer keeps.
+Fails if a translation unit only including `flags.h` includes one of
+these stream headers, which `flags_stream.h` is meant to keep out of it.
+
+Usage:
+  compile_benchmark.py [--cxx=c++] [--repeat=3] [--cxxflags=-O2] [--flags=10,100,1000]
+  compile_benchmark.py --generate=N [--output=FILE]  # writes a translation unit with N flags
+"""
+
+import argparse
+import os
+import pathlib
+import shlex
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = pathlib.Path(__file__).resolve().parents[2]
+
+FLAGS = """
+int main(int argc, char** argv) {
+  struct Flags : xdk::Flags<Flags> {
+    Flag<"--port", int>                       port{8080};
+    Flag<"--host", std::string>               host;
+    Flag<"--ratio", double>                   ratio;
+    Flag<"--tags", std::vector<std::string>>  tags;
+    Flag<"--verbose", bool, "-v">             verbose;
+  };
+  auto [flags, args, errors] = Flags::Parse(argc, argv);
+  return errors ? 1 : flags.port.value;
+}
+"""
+
+CASES = {
+    "empty": "int main() {}\n",
+    "<iostream>": "#include <iostream>\nint main() {}\n",
+    "flags.h": '#include "xdk/flags/flags.h"\n' + FLAGS,
+    "flags_stream.h": '#include "xdk/flags/flags_stream.h"\n' + FLAGS,
+    "flags_chrono.h": '#include "xdk/flags/flags_chrono.h"\n' + FLAGS,
+    "flags_intern.h": '#include "xdk/flags/flags_intern.h"\n' + FLAGS,
+}
+
+# Headers that `flags.h` must not include, even indirectly.
+STREAM_HEADERS = ("istream", "ostream", "sstream")
+
+# Types cycled through by generated flags, with an expression reducing a value to an int.
+TYPES = [
+    ("int", "{}.value"),
+    ("double", "static_cast<int>({}.value)"),
+    ("std::string", "static_cast<int>({}->size())"),
+    ("bool", "static_cast<int>({}.value)"),
+    ("std::vector<int>", "static_cast<int>({}->size())"),
+]
+
+
+def Generate(n):
+  """Returns a translation unit defining and parsing `n` flags."""
+  lines = [
+      "// Generated by compile_benchmark.py, do not edit.",
+      '#include <string>',
+      '#include <vector>',
+      '',
+      '#include "xdk/flags/flags.h"',
+      '',
+      "int main(int argc, char** argv) {",
+      "  struct Flags : xdk::Flags<Flags> {",
+  ]
+  for i in range(n):
+    lines.append(f'    Flag<"--flag_{i}", {TYPES[i % len(TYPES)][0]}> flag_{i};')
+  lines += [
+      "  };",
+      "  auto [flags, args, errors] = Flags::Parse(argc, argv);",
+      "  int sum = errors ? 1 : 0;",
+  ]
+  for i in range(n):
+    lines.append(f"  sum += {TYPES[i % len(TYPES)][1].format(f'flags.flag_{i}')};")
+  lines += ["  return sum;", "}", ""]
+  return "\n".join(lines)
+
+
+def Compile(cxx, cxxflags, source, obj):
+  command = [cxx, "-std=c++20", f"-I{ROOT}", *cxxflags, "-c", str(source), "-o", str(obj)]
+  start = time.perf_counter()
+  subprocess.run(command, check=True)
+  return time.perf_counter() - start
+
+
+def Instantiations(cxx, cxxflags, source, obj):
+  """Returns the number of functions of namespace `xdk` defined in `source` compiled at `-O0`."""
+  Compile(cxx, [*cxxflags, "-O0"], source, obj)
+  return sum(1 for symbol in Symbols(obj) if "xdk::" in symbol)
+
+
+def Run(*command):
+  try:
+    return subprocess.run(command, check=True, capture_output=True, text=True).stdout
+  except (OSError, subprocess.CalledProcessError):
+    return None
+
+
+def StreamHeaders(cxx, cxxflags, source):
+  """Returns the `STREAM_HEADERS` included by `source`, from the preprocessor's `-H` output."""
+  command = [cxx, "-std=c++20", f"-I{ROOT}", *cxxflags, "-E", "-H", str(source), "-o", os.devnull]
+  output = subprocess.run(command, check=True, capture_output=True, text=True).stderr
+  included = {
+      pathlib.PurePath(line.lstrip(". ")).name for line in output.splitlines()
+      if line.startswith(".")
+  }
+  return [header for header in STREAM_HEADERS if header in included]
+
+
+def TextSize(obj):
+  output = Run("size", str(obj))  # Berkeley format: text data bss dec hex filename
+  return output.splitlines()[1].split()[0] if output else "?"
+
+
+def Symbols(obj):
+  """Returns the demangled names of functions defined in `obj`."""
+  output = Run("nm", "-C", "--defined-only", str(obj)) or ""
+  return [
+      line.split(" ", 2)[2] for line in output.splitlines() if line.count(" ") >= 2 and
+      line.split(" ", 2)[1] in "TtWw"
+  ]
+
+
+def main():
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"))
+  parser.add_argument("--repeat", type=int, default=3)
+  parser.add_argument("--cxxflags", default="-O2")
+  parser.add_argument("--flags", default="10,100,1000")
+  parser.add_argument("--generate", type=int)
+  parser.add_argument("--output")
+  args = parser.parse_args()
+
+  if args.generate is not None:
+    if args.output:
+      pathlib.Path(args.output).write_text(Generate(args.generate))
+    else:
+      print(Generate(args.generate), end="")
+    return
+
+  cases = dict(CASES)
+  stream_free = {"flags.h"}  # cases only including flags.h
+  for n in filter(None, args.flags.split(",")):
+    cases[f"{n} flags"] = Generate(int(n))
+    stream_free.add(f"{n} flags")
+
+  print(f"{'case':<16} {'compile (s)':>12} {'object (B)':>12} {'.text (B)':>10} "
+        f"{'xdk inst':>8} {'ios init':>9}  streams")
+  failures = []
+  with tempfile.TemporaryDirectory() as tmp:
+    for name, code in cases.items():
+      source = pathlib.Path(tmp, "case.cc")
+      obj = pathlib.Path(tmp, "case.o")
+      source.write_text(code)
+      seconds = min(
+          Compile(args.cxx, shlex.split(args.cxxflags), source, obj) for _ in range(args.repeat))
+      size = obj.stat().st_size
+      text = TextSize(obj)
+      ios = "yes" if "ios_base::Init" in (Run("nm", "-C", str(obj)) or "") else "no"
+      xdk = Instantiations(args.cxx, shlex.split(args.cxxflags), source, obj)
+      streams = StreamHeaders(args.cxx, shlex.split(args.cxxflags), source)
+      print(f"{name:<16} {seconds:>12.3f} {size:>12} {text:>10} "
+            f"{xdk:>8} {ios:>9}  {' '.join(f'<{h}>' for h in streams) or '-'}")
+      if streams and name in stream_free:
+        failures.append(f"{name}: includes {', '.join(f'<{h}>' for h in streams)}")
+  if failures:
+    sys.exit("flags.h must not include stream headers:\n" + "\n".join(failures))
+
+
+if __name__ == "__main__":
+  main()
@@ -3,67 +3,383 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
 #include <cstddef>
-#include <functional>
-#include <iomanip>
-#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
 #include <optional>
-#include <sstream>
+#include <span>
+#include <string>
 #include <string_view>
-#include <typeinfo>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+// This header does not depend on iostreams. Include "xdk/flags/flags_stream.h"
+// for flags of types supporting `operator>>(std::istream&)`, and to stream
+// `FlagInfo::Errors` into a `std::ostream`.
+
 namespace xdk {
 
+// Calls `fn`, and returns false if it throws `std::bad_alloc`, so that callers
+// report allocation failures the same way with or without exceptions.
+template <typename Fn>
+bool CatchBadAlloc(Fn&& fn) {
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+  try {
+    std::forward<Fn>(fn)();
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+#else
+  std::forward<Fn>(fn)();
+#endif
+  return true;
+}
+
+// A minimal vector of trivially copyable values whose growth never throws:
+// `push_back` and `reserve` return false if memory can't be allocated. The
+// first `N` values are stored inline, without allocating. Other values are
+// allocated from `resource()`, or with `::operator new` if it is null.
+template <typename T, std::size_t N = 0>
+class Vector {
+  static_assert(std::is_trivially_copyable_v<T>, "values are copied with memcpy");
+
+ public:
+  using value_type     = T;
+  using iterator       = T*;
+  using const_iterator = const T*;
+  using size_type      = std::size_t;
+
+  Vector() = default;
+  explicit Vector(std::pmr::memory_resource* resource) : resource_(resource) {}
+  // Copies allocate from the resource of `other`. As allocation can't throw,
+  // a copy that can't allocate is left empty: check `size()` if it matters.
+  Vector(const Vector& other) : resource_(other.resource_) {
+    CopyFrom(other);
+  }
+  Vector& operator=(const Vector& other) {
+    if (this != &other) {
+      clear();
+      CopyFrom(other);
+    }
+    return *this;
+  }
+  Vector(Vector&& other) noexcept {
+    MoveFrom(other);
+  }
+  Vector& operator=(Vector&& other) noexcept {
+    if (this != &other) {
+      Deallocate();
+      MoveFrom(other);
+    }
+    return *this;
+  }
+  ~Vector() {
+    Deallocate();
+  }
+
+  [[nodiscard]] bool empty() const {
+    return size_ == 0;
+  }
+  [[nodiscard]] std::size_t size() const {
+    return size_;
+  }
+  T* data() {
+    return data_;
+  }
+  const T* data() const {
+    return data_;
+  }
+  T* begin() {
+    return data_;
+  }
+  const T* begin() const {
+    return data_;
+  }
+  T* end() {
+    return data_ + size_;
+  }
+  const T* end() const {
+    return data_ + size_;
+  }
+  T& operator[](std::size_t i) {
+    return data_[i];
+  }
+  const T& operator[](std::size_t i) const {
+    return data_[i];
+  }
+  T& back() {
+    return data_[size_ - 1];
+  }
+
+  bool push_back(const T& value) {  // NOLINT
+    if (size_ == capacity_ && !reserve(capacity_ == 0 ? 8 : 2 * capacity_)) return false;
+    data_[size_++] = value;
+    return true;
+  }
+
+  bool reserve(std::size_t capacity) {
+    if (capacity <= capacity_) return true;
+    if (capacity > std::numeric_limits<std::size_t>::max() / sizeof(T)) return false;
+    auto* data = static_cast<T*>(Allocate(capacity * sizeof(T)));
+    if (data == nullptr) return false;
+    if (size_ > 0) std::memcpy(data, data_, size_ * sizeof(T));
+    Deallocate();
+    data_     = data;
+    capacity_ = capacity;
+    return true;
+  }
+
+  void clear() {
+    size_ = 0;
+  }
+
+  void swap(Vector& other) noexcept {
+    Vector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+  }
+
+  [[nodiscard]] std::pmr::memory_resource* resource() const {
+    return resource_;
+  }
+
+ private:
+  [[nodiscard]] bool IsInline() const {
+    return data_ == inline_.data();
+  }
+
+  // Returns null if memory can't be allocated. A resource can only report it
+  // by throwing `std::bad_alloc`: without exceptions, that typically aborts.
+  void* Allocate(std::size_t bytes) {
+    if (resource_ == nullptr) return ::operator new(bytes, std::nothrow);
+    void* data = nullptr;
+    CatchBadAlloc([&] { data = resource_->allocate(bytes, alignof(T)); });
+    return data;
+  }
+
+  void Deallocate() {
+    if (IsInline()) return;
+    if (resource_ == nullptr) {
+      ::operator delete(data_);
+    } else {
+      resource_->deallocate(data_, capacity_ * sizeof(T), alignof(T));
+    }
+  }
+
+  void CopyFrom(const Vector& other) {
+    if (other.size_ == 0 || !reserve(other.size_)) return;
+    std::memcpy(data_, other.data_, other.size_ * sizeof(T));
+    size_ = other.size_;
+  }
+
+  // Leaves `other` empty, and `*this` with its values and resource.
+  // Without inline storage, `inline_.data()` is null and only the pointer moves.
+  void MoveFrom(Vector& other) {
+    resource_ = other.resource_;
+    if constexpr (N > 0) {
+      if (other.IsInline()) {
+        data_     = inline_.data();
+        capacity_ = N;
+        if (other.size_ > 0) std::memcpy(data_, other.data_, other.size_ * sizeof(T));
+        size_ = std::exchange(other.size_, 0);
+        return;
+      }
+    }
+    data_     = std::exchange(other.data_, other.inline_.data());
+    capacity_ = std::exchange(other.capacity_, N);
+    size_     = std::exchange(other.size_, 0);
+  }
+
+  std::array<T, N>           inline_;
+  T*                         data_     = inline_.data();
+  std::size_t                size_     = 0;
+  std::size_t                capacity_ = N;
+  std::pmr::memory_resource* resource_ = nullptr;
+};
+
 struct FlagInfo {
+  struct Type;
+
   // 1. Unknown flag
   //    `pos`: the index of argument that is not a flag
   //    `arg`: points to `argv[pos]` and starts by `-`
   //    `val`: points to `kUnknown`.
   // 2. Invalid flag value
   //    `pos`: the index of argument that is the flag
-  //    `arg`: points to `argv[pos]` and is the name of the flag
-  //    `val`: points to `argv[pos+1]` and is the string not valid as a value
-  // 3. Missing flag value
+  //    `arg`: points to `argv[pos]` and is the name of the flag, or `name=value`
+  //    `val`: points to `argv[pos+1]`, or after `=`, and is the string not valid as a value.
+  //           For a flag with several values, it may point to a later argument.
+  //    `type`: the type of the flag if it has choices, e.g. for an `Enum`.
+  //    `flag`: the name of the flag if `arg` is not only that, e.g. `-p` for `-pabc` or
+  //            `-xp`, `-O` for the prefix flag in `-Ox`, or `--port` for `--port=x`.
+  // 3. Missing flag value, or fewer values than the minimum of a flag with several values
   //    `pos`: as in previous case
   //    `arg`: as in previous case
   //    `val`: points to `nullptr`
+  //    `flag`: as in previous case
+  // 4. Invalid positional argument
+  //    `pos`: the index of the argument
+  //    `arg`: points to `argv[pos]`
+  //    `val`: points to `argv[pos]` too.
+  // 5. Out of memory
+  //    `pos`: the index of the argument that could not be stored or parsed, or
+  //           -1 for the default value of a flag, e.g. from `Default`
+  //    `arg`: points to `argv[pos]`, or the name of the flag
+  //    `val`: points to `kNoMemory`.
+  // 6. Missing required flag, or flags of the same exclusive group
+  //    `pos`: -1
+  //    `arg`: the name of the flag
+  //    `val`: points to `kRequired`, or the name of a previous flag of the group.
+  // 7. Positional member declared after one taking all the remaining arguments, e.g. `Rest`
+  //    `pos`: -1
+  //    `arg`: the name of the positional member, never filled
+  //    `val`: points to `kMisplaced`.
+  // 8. Invalid value of a `Lazy` flag, reported by `Flags::Validate`
+  //    `pos`: -1
+  //    `arg`: the name of the flag
+  //    `val`: the argument not valid as a value
+  //    `type`: as in case 2
+  //    `flag`: the name of the flag too, unlike in case 6.
   struct Error {
-    static inline const char kUnknown[] = "unknown";
+    static inline const char kUnknown[]   = "unknown";
+    static inline const char kNoMemory[]  = "no memory";
+    static inline const char kRequired[]  = "required";
+    static inline const char kMisplaced[] = "misplaced";
 
     int         pos = 0;
     const char* arg = nullptr;  // non-null for errors returnes by `Flags::Parse`.
     const char* val = kUnknown;
+    const Type* type = nullptr;  // to list the valid choices, if any
+    std::string_view flag = {};  // if not all of `arg`, e.g. `-p` for `-pabc`
 
     friend bool operator==(const FlagInfo::Error&, const FlagInfo::Error&) = default;
   };
 
-  struct Errors : public std::vector<Error> {
+  // The first `N` errors are stored without allocating.
+  template <std::size_t N>
+  struct BasicErrors : public Vector<Error, N> {
+    using Vector<Error, N>::Vector;
+
+    BasicErrors() = default;
+    // A copy that can't allocate all the errors is `lost`, so that it still
+    // converts to true.
+    BasicErrors(const BasicErrors& other)
+        : Vector<Error, N>(other), lost(other.lost || this->size() != other.size()) {}
+    BasicErrors& operator=(const BasicErrors& other) {
+      Vector<Error, N>::operator=(other);
+      lost = other.lost || this->size() != other.size();
+      return *this;
+    }
+    BasicErrors(BasicErrors&&) noexcept            = default;
+    BasicErrors& operator=(BasicErrors&&) noexcept = default;
+    ~BasicErrors()                                 = default;
+
+    bool lost = false;  // true if some errors could not be stored, for lack of memory.
+
     operator bool() const {  // NOLINT
-      return !empty();
+      return !this->empty() || lost;
     }
 
-    friend std::ostream& operator<<(std::ostream& os, const Errors& errors) {
-      os << '\n';
-      for (const auto& error : errors) {
+    void Add(const Error& error) {
+      if (!this->push_back(error)) lost = true;
+    }
+
+    // One line per error, preceded by an empty line.
+    [[nodiscard]] std::string ToString() const {
+      std::string str = "\n";
+      for (const auto& error : *this) {
+        if (error.pos < 0 && error.flag.empty()) {
+          if (error.val == Error::kRequired) {
+            str.append("Missing required flag `").append(error.arg).append("`\n");
+          } else if (error.val == Error::kNoMemory) {
+            str.append("Out of memory for the default value of flag `").append(error.arg);
+            str.append("`\n");
+          } else if (error.val == Error::kMisplaced) {
+            str.append("Positional member `").append(error.arg);
+            str.append("` is declared after the one taking the remaining arguments\n");
+          } else {
+            str.append("Flag `").append(error.arg).append("` conflicts with `");
+            str.append(error.val).append("`\n");
+          }
+          continue;
+        }
+        const std::string_view flag = error.flag.empty() ? error.arg : error.flag;
         if (error.val == Error::kUnknown) {
-          os << "Unknown flag `" << error.arg << '`';
+          str.append("Unknown flag `").append(error.arg);
+        } else if (error.val == Error::kNoMemory) {
+          str.append("Out of memory for argument `").append(error.arg);
         } else if (error.val == nullptr) {
-          os << "Missing value for flag `" << error.arg << '`';
+          str.append("Missing value for flag `").append(flag);
+        } else if (error.val == error.arg) {
+          str.append("Invalid argument `").append(error.arg);
         } else {
-          os << "Invalid value " << std::quoted(error.val) << " for flag `" << error.arg << '`';
+          str.append("Invalid value \"");
+          for (const char* c = error.val; *c != 0; ++c) {  // as `std::quoted`
+            if (*c == '"' || *c == '\\') str.push_back('\\');
+            str.push_back(*c);
+          }
+          str.append("\" for flag `").append(flag);
+        }
+        str.push_back('`');
+        if (error.pos >= 0) str.append(" at index ").append(std::to_string(error.pos));
+        if (error.type != nullptr) {
+          str.append(", expected one of:");
+          for (const std::string_view choice : error.type->choices) str.append(" ").append(choice);
         }
-        os << " at index " << error.pos << '\n';
+        str.push_back('\n');
       }
-      return os;
+      if (lost) str.append("Out of memory for other errors\n");
+      return str;
     }
   };
 
+  static constexpr std::size_t kInlineSize = 8;
+
+  using Errors = BasicErrors<kInlineSize>;
+
+  // Describes the type of a flag's value, without relying on RTTI.
+  struct Type {
+    enum class Kind { kIntegral, kFloating, kString, kVector, kOptional, kCustom, kEnum };
+
+    std::string_view name;  // as spelled by the compiler, e.g. `int` or `std::vector<int>`,
+                            // without the keywords of MSVC, e.g. `class`.
+    Kind             kind = Kind::kCustom;
+
+    // The only valid values, e.g. for an `Enum`.
+    std::span<const std::string_view> choices;
+  };
+
   // For introspection
-  std::string_view      name;
-  const std::type_info* type = nullptr;
-  std::string_view      alias;
+  std::string_view name;
+  const Type*      type = nullptr;
+  std::string_view alias;
+  std::span<const std::string_view> aliases;  // beyond `alias`, e.g. former names
+
+  // Whether `pred` holds for the name or an alias.
+  template <typename Pred>
+  [[nodiscard]] bool AnyName(Pred pred) const {
+    return pred(name) || pred(alias) || std::any_of(aliases.begin(), aliases.end(), pred);
+  }
+
+  // Calls `visit` with the name and each alias.
+  template <typename Visit>
+  void ForEachName(Visit visit) const {
+    visit(name);
+    visit(alias);
+    for (const std::string_view other : aliases) visit(other);
+  }
 
   template <size_t N>
   struct String {
@@ -79,18 +395,374 @@ struct FlagInfo {
     }
   };
 
-  enum class ParseStatus { kNoneParsed, kOneParsed, kTwoParsed, kParseMissing, kParseFailure };
+  enum class ParseStatus {
+    kNoneParsed,
+    kOneParsed,
+    kTwoParsed,
+    kParseMissing,
+    kParseFailure,
+    kParseNoMemory,
+  };
 
   // For parsing
-  std::size_t                                          size = 0;
-  std::function<ParseStatus(const char*, const char*)> parse;
+  std::size_t  size           = 0;
+  bool         has_value  : 1 = true;   // false for flags set by their name alone, e.g. bool
+  bool         prefix     : 1 = false;  // also matches `<name><value>`, e.g. `-I/usr/include`
+  bool         positional : 1 = false;  // matches arguments that are not flags, by position
+  bool         set        : 1 = false;  // by the command line, even if not to a valid value
+  bool         required   : 1 = false;  // an error if not set
+  bool         grouped    : 1 = false;  // counts for its exclusive group, unlike `--no-<name>`
+  std::uint8_t group          = 0;      // of mutually exclusive flags, from 1 to 64, or 0
+
+  // Values following the name, for flags with several values, e.g. `NArgs`, or
+  // arguments taken by a positional member, e.g. several for `Rest`
+  std::uint16_t min_values = 1;
+  std::uint16_t max_values = 1;
+
+  ParseStatus (*parse)(FlagInfo&, const char*) = nullptr;  // for a matching name, and value if any
+  bool (*fallback)(FlagInfo&) = nullptr;  // if not parsed, false if out of memory
+  void (*reserve)(FlagInfo&, std::size_t) = nullptr;  // for repeated flags, before parsing
+  void (*rebind)(FlagInfo&, std::pmr::memory_resource*) = nullptr;  // for allocator-aware values
+  const char* (*validate)(const FlagInfo&) = nullptr;  // for `Lazy` values, the invalid argument
+};
+
+// The values following a flag up to the next argument starting with `-`, e.g.
+// `--ids 1 2 3` for `Flag<"--ids", NArgs<int, 1, 3>>`, which saves repeating the
+// flag's name. There must be `Min` to `Max` of them, and repeating the flag
+// appends. A value attached with `=` is the only one of its occurrence.
+template <typename T, std::size_t Min = 1,
+          std::size_t Max = std::numeric_limits<std::uint16_t>::max()>
+struct NArgs : std::vector<T> {
+  static_assert(Min <= Max && Max > 1 && Max <= std::numeric_limits<std::uint16_t>::max());
+
+  static constexpr std::size_t kMin = Min;
+  static constexpr std::size_t kMax = Max;
+
+  using std::vector<T>::vector;
+};
+
+// Whether `T` is an `NArgs`, rather than any type with `kMin` and `kMax`.
+template <typename T>
+struct IsNArgs : std::false_type {};
+
+template <typename T, std::size_t Min, std::size_t Max>
+struct IsNArgs<NArgs<T, Min, Max>> : std::true_type {};
+
+// A name for the value `V` of an `Enum`.
+template <FlagInfo::String N, auto V>
+struct Choice {
+  static constexpr std::string_view kName{N.array.data(), N.array.size() - 1};
+  static constexpr auto             kValue = V;
+};
+
+// The FNV-1a hash of `str`, continuing from `hash`, so that a name can be
+// hashed in several parts.
+constexpr std::uint32_t HashName(std::string_view str, std::uint32_t hash = 2166136261U) {
+  for (const char c : str) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+  return hash;
+}
+
+// Spreads every bit of `hash` over all the others (the finalizer of
+// MurmurHash3), as FNV-1a alone leaves its low bits depending only on the low
+// bits of the characters.
+constexpr std::uint32_t MixHash(std::uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bU;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35U;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+// Maps `N` distinct names to their index plus one, found at compile time by
+// hash and displace: the names are split into buckets, and each bucket, the
+// largest first, gets the first seed placing its names in free slots of a
+// table twice larger than the names.
+template <std::size_t N>
+class PerfectHash {
+ public:
+  // The names must be `Distinct`: no seed separates duplicates, so the hash is
+  // then left empty, for the caller's `static_assert` to report, as when the
+  // search gives up, see `Found`.
+  constexpr explicit PerfectHash(const std::array<std::string_view, N>& names) {
+    if (!Distinct(names)) return;
+    std::array<std::uint32_t, N> hashes{};
+    std::array<std::size_t, kBuckets> sizes{};
+    for (std::size_t i = 0; i < N; ++i) {
+      hashes[i] = HashName(names[i]);
+      ++sizes[Bucket(hashes[i])];
+    }
+    for (std::size_t size = N; size > 0; --size) {
+      for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+        if (sizes[bucket] == size && !Place(hashes, bucket)) return;
+      }
+    }
+    found_ = true;
+  }
+
+  [[nodiscard]] static constexpr bool Distinct(const std::array<std::string_view, N>& names) {
+    for (std::size_t i = 0; i < N; ++i) {
+      for (std::size_t j = i + 1; j < N; ++j) {
+        if (names[i] == names[j]) return false;
+      }
+    }
+    return true;
+  }
+
+  // Whether a seed was found for every bucket, which only fails in practice
+  // for distinct names with the same 32 bits hash.
+  [[nodiscard]] constexpr bool Found() const {
+    return found_;
+  }
+
+  // The index plus one of `name` if it is one of the names, else any index
+  // plus one, or 0.
+  [[nodiscard]] constexpr std::size_t operator()(std::string_view name) const {
+    const std::uint32_t hash = HashName(name);
+    return slots_[Slot(hash, seeds_[Bucket(hash)])];
+  }
+
+ private:
+  static constexpr std::size_t   kBuckets  = std::bit_ceil(N);
+  static constexpr std::size_t   kSlots    = 2 * kBuckets;
+  static constexpr std::uint32_t kMaxSeeds = 1U << 12;
+
+  static constexpr std::size_t Bucket(std::uint32_t hash) {
+    return MixHash(hash) & (kBuckets - 1);
+  }
+
+  // The high bits, as `Bucket` uses the low ones.
+  static constexpr std::size_t Slot(std::uint32_t hash, std::uint32_t seed) {
+    return MixHash(hash ^ (seed * 0x9e3779b9U)) >> (32 - std::countr_zero(kSlots));
+  }
+
+  // Finds the seed of `bucket` for which its names fall in distinct free slots.
+  constexpr bool Place(const std::array<std::uint32_t, N>& hashes, std::size_t bucket) {
+    for (std::uint32_t seed = 0; seed < kMaxSeeds; ++seed) {
+      std::size_t i = 0;
+      for (; i < N; ++i) {
+        if (Bucket(hashes[i]) != bucket) continue;
+        auto& slot = slots_[Slot(hashes[i], seed)];
+        if (slot != 0) break;
+        slot = static_cast<std::uint8_t>(i + 1);
+      }
+      if (i == N) {
+        seeds_[bucket] = static_cast<std::uint16_t>(seed);
+        return true;
+      }
+      for (std::size_t j = 0; j < i; ++j) {  // frees the slots taken with this seed
+        if (Bucket(hashes[j]) == bucket) slots_[Slot(hashes[j], seed)] = 0;
+      }
+    }
+    return false;
+  }
+
+  bool                                found_ = false;
+  std::array<std::uint16_t, kBuckets> seeds_{};
+  std::array<std::uint8_t, kSlots>    slots_{};
+};
+
+// An enumeration parsed from the names of its values, e.g. `Flag<"--mode",
+// Enum<Mode, Choice<"fast", Mode::kFast>, Choice<"safe", Mode::kSafe>>> mode`.
+// Names are matched with a `PerfectHash`. The default value is the first one.
+template <typename E, typename... Choices>
+class Enum {
+  static_assert(sizeof...(Choices) > 0 && sizeof...(Choices) < 256);
+
+ public:
+  static constexpr std::array<std::string_view, sizeof...(Choices)> kNames{Choices::kName...};
+  static constexpr std::array<E, sizeof...(Choices)>                kValues{Choices::kValue...};
+  static_assert(PerfectHash<sizeof...(Choices)>::Distinct(kNames),
+                "choices must have distinct names");
+
+  constexpr Enum() = default;
+  constexpr Enum(E value) : value(value) {}  // NOLINT
+
+  constexpr operator E() const {  // NOLINT
+    return value;
+  }
+  friend constexpr bool operator==(const Enum& lhs, const Enum& rhs) = default;
+
+  // The value named `name`, if any.
+  static constexpr const E* Find(std::string_view name) {
+    const std::size_t index = kHash(name);
+    return index != 0 && kNames[index - 1] == name ? &kValues[index - 1] : nullptr;
+  }
+
+  E value = kValues[0];
+
+ private:
+  static constexpr PerfectHash<sizeof...(Choices)> kHash{kNames};
+  static_assert(kHash.Found() || !PerfectHash<sizeof...(Choices)>::Distinct(kNames),
+                "no perfect hash found for the names of the choices: rename one of them");
+};
+
+template <typename T>
+constexpr std::string_view TypeName() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  constexpr std::string_view kSignature = __FUNCSIG__;  // ...TypeName<int>(void)
+  constexpr std::size_t      kBegin     = kSignature.find("TypeName<") + 9;
+  constexpr std::size_t      kEnd       = kSignature.rfind(">(void)");
+#else
+  constexpr std::string_view kSignature = __PRETTY_FUNCTION__;  // ...[with T = int; ...]
+  constexpr std::size_t      kBegin     = kSignature.find("T = ") + 4;
+  constexpr std::size_t      kEnd       = kSignature.find_first_of(";]", kBegin);
+#endif
+  return kSignature.substr(kBegin, kEnd - kBegin);
+}
+
+// Copies the type name `name` to `out`, unless null, and returns the size of
+// the copy. The keywords and spaces that MSVC adds are dropped, so that names
+// are the same across compilers, e.g. `std::vector<int,std::allocator<int>>`
+// for `class std::vector<int,class std::allocator<int> >`.
+constexpr std::size_t CopyTypeName(std::string_view name, char* out) {
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < name.size();) {
+    const bool  word = i == 0 || name[i - 1] == '<' || name[i - 1] == ',' || name[i - 1] == '(';
+    std::size_t skip = name[i] == ' ' && i + 1 < name.size() && name[i + 1] == '>' ? 1 : 0;
+    for (const std::string_view keyword : {"class ", "struct ", "union ", "enum "}) {
+      if (word && name.substr(i).starts_with(keyword)) skip = keyword.size();
+    }
+    if (skip == 0 && out != nullptr) out[size] = name[i];
+    if (skip == 0) ++size;
+    i += std::max<std::size_t>(skip, 1);
+  }
+  return size;
+}
+
+// Copy of `TypeName<T>()`, so that it does not refer to a function's local.
+template <typename T>
+inline constexpr auto kTypeName = [] {
+  constexpr std::string_view name = TypeName<T>();
+  std::array<char, CopyTypeName(name, nullptr)> array{};
+  CopyTypeName(name, array.data());
+  return array;
+}();
+
+template <typename T>
+struct TypeKind
+    : std::integral_constant<
+          FlagInfo::Type::Kind,
+          std::is_integral_v<T>                   ? FlagInfo::Type::Kind::kIntegral
+          : std::is_floating_point_v<T>           ? FlagInfo::Type::Kind::kFloating
+          : std::is_assignable_v<T&, const char*> ? FlagInfo::Type::Kind::kString
+                                                  : FlagInfo::Type::Kind::kCustom> {};
+
+template <typename T, typename A>
+struct TypeKind<std::vector<T, A>>
+    : std::integral_constant<FlagInfo::Type::Kind, FlagInfo::Type::Kind::kVector> {};
+
+template <typename T, std::size_t Min, std::size_t Max>
+struct TypeKind<NArgs<T, Min, Max>>
+    : std::integral_constant<FlagInfo::Type::Kind, FlagInfo::Type::Kind::kVector> {};
+
+template <typename E, typename... Choices>
+struct TypeKind<Enum<E, Choices...>>
+    : std::integral_constant<FlagInfo::Type::Kind, FlagInfo::Type::Kind::kEnum> {};
+
+template <typename T>
+struct TypeKind<std::optional<T>>
+    : std::integral_constant<FlagInfo::Type::Kind, FlagInfo::Type::Kind::kOptional> {};
+
+template <typename T>
+inline constexpr std::span<const std::string_view> kChoices{};
+
+template <typename E, typename... Choices>
+inline constexpr std::span<const std::string_view> kChoices<Enum<E, Choices...>> =
+    Enum<E, Choices...>::kNames;
+
+// The choices of the values of a flag with several or optional ones.
+template <typename T, typename A>
+inline constexpr std::span<const std::string_view> kChoices<std::vector<T, A>> = kChoices<T>;
+
+template <typename T, std::size_t Min, std::size_t Max>
+inline constexpr std::span<const std::string_view> kChoices<NArgs<T, Min, Max>> = kChoices<T>;
+
+template <typename T>
+inline constexpr std::span<const std::string_view> kChoices<std::optional<T>> = kChoices<T>;
+
+template <typename T>
+inline constexpr FlagInfo::Type kType{
+    .name    = {kTypeName<T>.data(), kTypeName<T>.size()},
+    .kind    = TypeKind<T>::value,
+    .choices = kChoices<T>,
+};
+
+// Same as `std::from_chars` for a floating-point `value`, with `std::strtod`,
+// for standard libraries without it, e.g. libc++ before LLVM 20. `begin` must
+// point to a null-terminated string. As `std::from_chars`, it rejects leading
+// spaces, `+` and hexadecimal values, and leaves `value` unchanged on error.
+template <typename T>
+std::from_chars_result StrToFloat(const char* begin, T& value) {
+  const char* digits = begin + (*begin == '-' ? 1 : 0);
+  if (*begin == '+' || std::isspace(static_cast<unsigned char>(*digits)) != 0 ||
+      (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X'))) {
+    return {begin, std::errc::invalid_argument};
+  }
+  const int saved_errno = errno;
+  errno                 = 0;
+  char* parsed          = nullptr;
+  T     parsed_value{};
+  if constexpr (std::is_same_v<T, float>) {
+    parsed_value = std::strtof(begin, &parsed);
+  } else if constexpr (std::is_same_v<T, double>) {
+    parsed_value = std::strtod(begin, &parsed);
+  } else {
+    parsed_value = std::strtold(begin, &parsed);
+  }
+  const bool out_of_range = errno == ERANGE;
+  errno                   = saved_errno;
+  if (parsed == begin) return {begin, std::errc::invalid_argument};
+  if (out_of_range) return {parsed, std::errc::result_out_of_range};
+  value = parsed_value;
+  return {parsed, std::errc()};
+}
+
+// Same as `std::from_chars`, but also accepting a leading `+` as `operator>>`
+// does, e.g. `+5`, though not before another sign, e.g. `+-5`.
+template <typename T>
+std::from_chars_result FromChars(const char* begin, const char* end, T& value) {
+  if (end - begin > 1 && begin[0] == '+' && begin[1] != '-' && begin[1] != '+') ++begin;
+#if !defined(__cpp_lib_to_chars) || __cpp_lib_to_chars < 201611L
+  if constexpr (std::is_floating_point_v<T>) {
+    return StrToFloat(begin, value);
+  } else {
+    return std::from_chars(begin, end, value);
+  }
+#else
+  return std::from_chars(begin, end, value);
+#endif
+}
+
+// Parses values of the types `ParseValue` does not handle itself, with a
+// static `bool Parse(const char* arg, T& value)`. It is specialized for the
+// types supporting `operator>>(std::istream&)` in "xdk/flags/flags_stream.h",
+// and for `std::chrono::duration` in "xdk/flags/flags_chrono.h", so that their
+// standard headers are only included where needed.
+template <typename T, typename = void>
+struct ValueParser {
+  static_assert(sizeof(T) == 0,
+                "no ValueParser for this type: specialize it, or include xdk/flags/flags_stream.h "
+                "if the type supports operator>>(std::istream&), or xdk/flags/flags_chrono.h "
+                "for a std::chrono::duration");
 };
 
 template <typename T>
 bool ParseValue(const char* arg, T& value) {
-  std::istringstream stream(arg);
-  stream >> value;
-  return !stream.fail();
+  if constexpr (std::is_same_v<T, bool>) {
+    const std::string_view str = arg;
+    value                      = str == "1" || str == "true";
+    return value || str == "0" || str == "false";
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    const char* end          = arg + std::char_traits<char>::length(arg);
+    const auto [parsed, err] = FromChars(arg, end, value);
+    return err == std::errc() && parsed == end;
+  } else if constexpr (std::is_assignable_v<T&, const char*>) {  // e.g. strings
+    value = arg;
+    return true;
+  } else {
+    return ValueParser<T>::Parse(arg, value);
+  }
 }
 
 template <>
@@ -99,40 +771,372 @@ inline bool ParseValue(const char* arg, char& value) {
   return arg[1] == 0;
 }
 
-template <typename T>
-bool ParseValue(const char* arg, std::vector<T>& value) {
+// A number of bytes, parsed with an optional unit, either decimal (`kB`, `MB`,
+// `GB`, `TB`, `PB`, `EB`) or binary (`KiB`, `MiB`, `GiB`, `TiB`, `PiB`, `EiB`),
+// e.g. `4GiB`. `B` is also accepted, and `KB` is `kB`.
+struct ByteSize {
+  std::uint64_t value = 0;
+
+  constexpr operator std::uint64_t() const {  // NOLINT
+    return value;
+  }
+};
+
+inline bool ParseValue(const char* arg, ByteSize& size) {
+  const char*   end        = arg + std::char_traits<char>::length(arg);
+  std::uint64_t count      = 0;
+  const auto [suffix, err] = FromChars(arg, end, count);
+  if (err != std::errc() || suffix == arg) return false;
+  const std::string_view unit(suffix, end - suffix);
+  int                    power = 0;  // of the base
+  switch (unit.empty() ? 'B' : unit[0]) {
+    case 'B':
+      if (unit.size() > 1) return false;
+      break;
+    case 'k':
+    case 'K': power = 1; break;
+    case 'M': power = 2; break;
+    case 'G': power = 3; break;
+    case 'T': power = 4; break;
+    case 'P': power = 5; break;
+    case 'E': power = 6; break;
+    default:  return false;
+  }
+  std::uint64_t base = 1'000;
+  if (power > 0 && unit.substr(1) == "iB") {
+    base = 1'024;
+  } else if (power > 0 && unit.substr(1) != "B") {
+    return false;
+  }
+  for (; power > 0; --power) {
+    if (count > std::numeric_limits<std::uint64_t>::max() / base) return false;
+    count *= base;
+  }
+  size.value = count;
+  return true;
+}
+
+template <typename T, typename A>
+bool ParseValue(const char* arg, std::vector<T, A>& value) {
   value.emplace_back();
   return ParseValue(arg, value.back());
 }
 
+template <typename T, std::size_t Min, std::size_t Max>
+bool ParseValue(const char* arg, NArgs<T, Min, Max>& values) {
+  return ParseValue(arg, static_cast<std::vector<T>&>(values));
+}
+
 template <typename T>
 bool ParseValue(const char* arg, std::optional<T>& value) {
   value.emplace();
   return ParseValue(arg, *value);
 }
 
-template <FlagInfo::String L, typename T, FlagInfo::String A = L>
-class Flag final : private FlagInfo {
-  static_assert(L.IsValid(), "must start with - and be different from --");
-  static_assert(A.IsValid(), "must start with - and be different from --");
+// A value that keeps the raw command line argument and only converts it with
+// `ParseValue` when first accessed, which is useful for types that are costly
+// to parse. Conversion happens at most once, even under concurrent accesses.
+// If there is no argument, the value is the one the `Lazy` was constructed
+// with. `Validate()` forces the conversion and tells whether it succeeded.
+// A copy converts on its own first access, unless the original already did,
+// but copying must not race with the first access of the original.
+template <typename T>
+class Lazy {
+ public:
+  template <typename... Args>
+  explicit Lazy(Args&&... args) : value_(std::forward<Args>(args)...) {}
+
+  // A copy has not been accessed yet, so it gets a fresh `once_`.
+  Lazy(const Lazy& other)
+    requires std::is_copy_constructible_v<T>
+      : arg_(other.arg_), converted_(other.converted_), ok_(other.ok_), value_(other.value_) {}
+  Lazy(Lazy&& other) noexcept
+      : arg_(other.arg_),
+        converted_(other.converted_),
+        ok_(other.ok_),
+        value_(std::move(other.value_)) {}
+  Lazy& operator=(const Lazy& other)
+    requires std::is_copy_assignable_v<T>
+  {
+    if (this != &other) Assign(other.value_, other);
+    return *this;
+  }
+  Lazy& operator=(Lazy&& other) noexcept {
+    if (this != &other) Assign(std::move(other.value_), other);
+    return *this;
+  }
+  ~Lazy() = default;
+
+  [[nodiscard]] bool Validate() const {
+    Convert();
+    return ok_;
+  }
+
+  // The command line argument, or null if there was none.
+  [[nodiscard]] const char* arg() const {
+    return arg_;
+  }
+
+  const T& value() const {
+    Convert();
+    return value_;
+  }
+  const T& operator*() const {
+    return value();
+  }
+  const T* operator->() const {
+    return &value();
+  }
+
+ private:
+  template <typename U>
+  friend bool ParseValue(const char* arg, Lazy<U>& value);
+
+  void Convert() const {
+    std::call_once(once_, [this] {
+      if (arg_ != nullptr && !converted_) ok_ = ParseValue(arg_, value_);
+      converted_ = true;
+    });
+  }
+
+  template <typename V>
+  void Assign(V&& value, const Lazy& other) {
+    value_     = std::forward<V>(value);
+    arg_       = other.arg_;
+    converted_ = other.converted_;
+    ok_        = other.ok_;
+    std::destroy_at(&once_);  // a `std::once_flag` can't be reset nor assigned
+    std::construct_at(&once_);
+  }
+
+  mutable std::once_flag once_;
+  const char*            arg_       = nullptr;
+  mutable bool           converted_ = false;
+  mutable bool           ok_        = true;
+  mutable T              value_;
+};
+
+template <typename T>
+bool ParseValue(const char* arg, Lazy<T>& value) {
+  value.arg_       = arg;
+  value.converted_ = false;
+  return true;
+}
+
+template <typename T>
+struct IsLazy : std::false_type {};
+
+template <typename T>
+struct IsLazy<Lazy<T>> : std::true_type {};
+
+// The number of times a flag appears, e.g. 3 for `-vvv` or `-v -v -v` with
+// `Flag<"-v", Count> verbosity`, saturating at 255. As for `bool`, a value can
+// be given with `=`, e.g. `--verbose=2`.
+struct Count {
+  std::uint8_t value = 0;
+
+  constexpr operator std::uint8_t() const {  // NOLINT
+    return value;
+  }
+};
+
+inline bool ParseValue(const char* arg, Count& count) {
+  return ParseValue(arg, count.value);
+}
+
+template <typename E, typename... Choices>
+bool ParseValue(const char* arg, Enum<E, Choices...>& value) {
+  const E* found = Enum<E, Choices...>::Find(arg);
+  if (found != nullptr) value.value = *found;
+  return found != nullptr;
+}
+
+// Whether flags of type `T` are followed by a value, rather than being set by
+// their name alone.
+template <typename T>
+inline constexpr bool kHasValue = !std::is_same_v<T, bool> && !std::is_same_v<T, Count>;
+
+// Tag to initialize a flag with the result of `Factory()` only if it does not
+// appear on the command line, e.g. `Flag<"--table", Table> table{Default<BuildTable>{}}`.
+// The flag's type must be default constructible and move assignable.
+template <auto Factory>
+struct Default {};
+
+// Tags to constrain a flag, e.g. `Flag<"--port", int> port{Range<1, 65535>{}, 8080}`,
+// checked while parsing, which reports the errors. `Range` applies to the last
+// value of vectors, and to the value of optionals.
+template <auto Min, auto Max>
+struct Range {};
+
+// Whether `T` is an integer type comparable with `std::cmp_less_equal`, which
+// excludes `bool` and the character types.
+template <typename T>
+inline constexpr bool kIsInteger =
+    std::is_integral_v<T> && !std::is_same_v<T, bool> && !std::is_same_v<T, char> &&
+    !std::is_same_v<T, wchar_t> && !std::is_same_v<T, char8_t> && !std::is_same_v<T, char16_t> &&
+    !std::is_same_v<T, char32_t>;
+
+// Whether `value` is in `[Min, Max]`, comparing integers by value whatever
+// their signedness, e.g. `3u` is in `Range<-1, 5>`.
+template <auto Min, auto Max, typename V>
+constexpr bool InRange(const V& value) {
+  if constexpr (kIsInteger<V> && kIsInteger<decltype(Min)> && kIsInteger<decltype(Max)>) {
+    return std::cmp_less_equal(Min, value) && std::cmp_less_equal(value, Max);
+  } else {
+    return Min <= value && value <= Max;
+  }
+}
+
+struct Required {};  // must be set by the command line
+
+// At most one flag of the group `G` may be set by the command line. Flags
+// without a value only count if left true or non-zero, e.g. not `--no-json`.
+template <std::size_t G>
+struct ExclusiveGroup {
+  static_assert(G >= 1 && G <= 64, "must be from 1 to 64");
+};
 
+// Holds the value of a `Flag`. Parsing a value only depends on its type, so
+// that all flags of a given type share the same functions. Flag names are
+// matched by `Flags::Parse`.
+template <typename T>
+class FlagValue : public FlagInfo {
  public:
+  T value;
+
+ protected:
   template <typename... Args>
-  explicit Flag(Args&&... args) : value(std::forward<Args>(args)...) {
-    size  = sizeof(*this);
-    parse = [this](const char* name, const char* value) {
-      using enum ParseStatus;
-      if (kL != name && kA != name) return kNoneParsed;
-      if constexpr (std::is_same<T, bool>::value) {
-        this->value = true;
+  constexpr explicit FlagValue(Args&&... args) : value(std::forward<Args>(args)...) {
+    parse     = &Parse;
+    has_value = kHasValue<T>;
+    if constexpr (IsNArgs<T>::value) {  // values counted anyway
+      min_values = T::kMin;
+      max_values = T::kMax;
+      reserve    = &Reserve;
+    } else if constexpr (TypeKind<T>::value == Type::Kind::kVector) {
+      // Growing a vector of trivially copyable values is cheaper than counting them upfront.
+      if constexpr (!std::is_trivially_copyable_v<typename T::value_type>) reserve = &Reserve;
+    }
+    if constexpr (std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>) rebind = &Rebind;
+    if constexpr (IsLazy<T>::value) validate = &Validate;
+  }
+
+  static ParseStatus Parse(FlagInfo& info, const char* value) {
+    using enum ParseStatus;
+    auto& flag   = static_cast<FlagValue&>(info);
+    flag.grouped = true;
+    if constexpr (!kHasValue<T>) {
+      if (value == nullptr) {  // the value is only given as `--flag=value`
+        if constexpr (std::is_same_v<T, Count>) {
+          flag.value.value += flag.value < std::numeric_limits<std::uint8_t>::max() ? 1 : 0;
+        } else {
+          flag.value = true;
+        }
         return kOneParsed;
       }
-      if (value == nullptr || value[0] == '-') return kParseMissing;
-      return ParseValue(value, this->value) ? kTwoParsed : kParseFailure;
-    };
-    name  = kL;
-    type  = &typeid(T);
-    alias = kA;
+    }
+    if (value == nullptr) return kParseMissing;
+    bool parsed = false;
+    if (!CatchBadAlloc([&] { parsed = ParseValue(value, flag.value); })) return kParseNoMemory;
+    // A flag without a value set to false or 0, e.g. by `--no-<name>`, is not
+    // in conflict with the other flags of its group.
+    if constexpr (!kHasValue<T>) flag.grouped = static_cast<bool>(flag.value);
+    return parsed ? kTwoParsed : kParseFailure;
+  }
+
+  // Same as `Parse`, but a value not in `[Min, Max]` is invalid.
+  template <auto Min, auto Max>
+  static ParseStatus ParseInRange(FlagInfo& info, const char* value) {
+    const ParseStatus status = Parse(info, value);
+    if (status != ParseStatus::kTwoParsed) return status;
+    const auto& checked = [&]() -> const auto& {
+      const T& parsed = static_cast<FlagValue&>(info).value;
+      if constexpr (TypeKind<T>::value == Type::Kind::kVector) {
+        return parsed.back();
+      } else if constexpr (TypeKind<T>::value == Type::Kind::kOptional) {
+        return *parsed;
+      } else {
+        return parsed;
+      }
+    }();
+    return InRange<Min, Max>(checked) ? status : ParseStatus::kParseFailure;
+  }
+
+  // Makes room for `count` more elements. It is only a hint, so failing to
+  // allocate is left to be reported by `Parse`.
+  static void Reserve(FlagInfo& info, std::size_t count) {
+    auto& value = static_cast<FlagValue&>(info).value;
+    CatchBadAlloc([&] { value.reserve(value.size() + count); });
+  }
+
+  // Moves the value to memory allocated from `resource`, with its
+  // allocator-extended move constructor. The value keeps its allocator if that
+  // fails.
+  static void Rebind(FlagInfo& info, std::pmr::memory_resource* resource) {
+    using Allocator = std::pmr::polymorphic_allocator<>;
+    auto& value     = static_cast<FlagValue&>(info).value;
+    CatchBadAlloc([&] {
+      T rebound = [&] {
+        if constexpr (std::is_constructible_v<T, T&&, const Allocator&>) {
+          return T(std::move(value), Allocator(resource));
+        } else {
+          return T(std::allocator_arg, Allocator(resource), std::move(value));
+        }
+      }();
+      value.~T();
+      ::new (static_cast<void*>(&value)) T(std::move(rebound));  // moves the allocator too
+    });
+  }
+
+  // Converts a `Lazy` value, and returns its argument if it is not valid.
+  static const char* Validate(const FlagInfo& info) {
+    const auto& value = static_cast<const FlagValue&>(info).value;
+    return value.Validate() ? nullptr : value.arg();
+  }
+
+  template <auto Factory>
+  static bool Fallback(FlagInfo& info) {
+    return CatchBadAlloc([&] { static_cast<FlagValue&>(info).value = Factory(); });
+  }
+};
+
+template <FlagInfo::String L, typename T, FlagInfo::String A = L, FlagInfo::String... As>
+class Flag final : private FlagValue<T> {
+  static_assert(L.IsValid(), "must start with - and be different from --");
+  static_assert(A.IsValid(), "must start with - and be different from --");
+  static_assert((As.IsValid() && ...), "must start with - and be different from --");
+
+ public:
+  template <typename... Args>
+  constexpr explicit Flag(Args&&... args) : FlagValue<T>(std::forward<Args>(args)...) {
+    this->size  = sizeof(*this);
+    this->name  = kL;
+    this->type  = &kType<T>;
+    this->alias = kA;
+    if constexpr (sizeof...(As) > 0) this->aliases = kAs;
+  }
+
+  template <auto Factory>
+  constexpr explicit Flag(Default<Factory> /*unused*/) : Flag() {
+    this->fallback = &FlagValue<T>::template Fallback<Factory>;
+  }
+
+  template <auto Min, auto Max, typename... Args>
+  constexpr explicit Flag(Range<Min, Max> /*unused*/, Args&&... args)
+      : Flag(std::forward<Args>(args)...) {
+    static_assert(kHasValue<T>, "Range needs a flag taking a value, not a bool nor a Count");
+    this->parse = &FlagValue<T>::template ParseInRange<Min, Max>;
+  }
+
+  template <typename... Args>
+  constexpr explicit Flag(Required /*unused*/, Args&&... args) : Flag(std::forward<Args>(args)...) {
+    this->required = true;
+  }
+
+  template <std::size_t G, typename... Args>
+  constexpr explicit Flag(ExclusiveGroup<G> /*unused*/, Args&&... args)
+      : Flag(std::forward<Args>(args)...) {
+    this->group = G;
   }
 
   operator const T&() const {  // NOLINT
@@ -142,44 +1146,271 @@ class Flag final : private FlagInfo {
     return &value;
   }
 
-  T value;
+  using FlagValue<T>::value;
 
  private:
   static constexpr std::string_view kL{L.array.data(), L.array.size() - 1};
   static constexpr std::string_view kA{A.array.data(), A.array.size() - 1};
+  static constexpr std::array<std::string_view, sizeof...(As)> kAs{
+      std::string_view{As.array.data(), As.array.size() - 1}...};
+};
+
+// A flag whose value may be attached to its name, as in compiler command lines,
+// e.g. `PrefixFlag<"-I", std::vector<std::string_view>>` matches `-I/usr/include`
+// and `-I /usr/include`. The value is the rest of the argument, without copy.
+template <FlagInfo::String P, typename T>
+class PrefixFlag final : private FlagValue<T> {
+  static_assert(P.IsValid(), "must start with - and be different from --");
+
+ public:
+  template <typename... Args>
+  constexpr explicit PrefixFlag(Args&&... args) : FlagValue<T>(std::forward<Args>(args)...) {
+    this->size   = sizeof(*this);
+    this->name   = kP;
+    this->type   = &kType<T>;
+    this->alias  = kP;
+    this->prefix = true;
+  }
+
+  operator const T&() const {  // NOLINT
+    return value;
+  }
+  const T* operator->() const {
+    return &value;
+  }
+
+  using FlagValue<T>::value;
+
+ private:
+  static constexpr std::string_view kP{P.array.data(), P.array.size() - 1};
 };
 
-template <typename F>
+// An argument that is not a flag, e.g. `Positional<"source", std::string>` for
+// the first one if it is the first `Positional` member. It takes a single
+// argument, so its type can't be an `NArgs`. The name is only used for
+// introspection.
+template <FlagInfo::String N, typename T>
+class Positional final : private FlagValue<T> {
+  static_assert(N.array.size() > 1 && N.array[0] != '-', "must not be empty nor start with -");
+  static_assert(!IsNArgs<T>::value, "takes one argument: use Rest for the remaining ones");
+
+ public:
+  template <typename... Args>
+  constexpr explicit Positional(Args&&... args) : FlagValue<T>(std::forward<Args>(args)...) {
+    this->size       = sizeof(*this);
+    this->name       = kN;
+    this->type       = &kType<T>;
+    this->alias      = kN;
+    this->positional = true;
+  }
+
+  operator const T&() const {  // NOLINT
+    return value;
+  }
+  const T* operator->() const {
+    return &value;
+  }
+
+  using FlagValue<T>::value;
+
+ private:
+  static constexpr std::string_view kN{N.array.data(), N.array.size() - 1};
+};
+
+// The arguments that are not flags after those taken by the `Positional`
+// members, e.g. `Rest<std::string_view> files`. It is declared last.
+template <typename T>
+class Rest final : private FlagValue<std::vector<T>> {
+ public:
+  template <typename... Args>
+  constexpr explicit Rest(Args&&... args)
+      : FlagValue<std::vector<T>>(std::forward<Args>(args)...) {
+    this->size       = sizeof(*this);
+    this->name       = "...";
+    this->type       = &kType<std::vector<T>>;
+    this->alias      = "...";
+    this->positional = true;
+    this->max_values = std::numeric_limits<std::uint16_t>::max();  // is not limited
+  }
+
+  operator const std::vector<T>&() const {  // NOLINT
+    return value;
+  }
+  const std::vector<T>* operator->() const {
+    return &value;
+  }
+
+  using FlagValue<std::vector<T>>::value;
+};
+
+// `N` is the number of arguments and errors that `Parse` stores without
+// allocating.
+template <typename F, std::size_t N = FlagInfo::kInlineSize>
 class Flags {
  public:
-  template <FlagInfo::String L, typename T, FlagInfo::String A = L>
-  using Flag = ::xdk::Flag<L, T, A>;
+  template <FlagInfo::String L, typename T, FlagInfo::String A = L, FlagInfo::String... As>
+  using Flag = ::xdk::Flag<L, T, A, As...>;
+
+  template <FlagInfo::String P, typename T>
+  using PrefixFlag = ::xdk::PrefixFlag<P, T>;
+
+  template <FlagInfo::String P, typename T>
+  using Positional = ::xdk::Positional<P, T>;
+
+  template <typename T>
+  using Rest = ::xdk::Rest<T>;
+
+  // The arguments that are neither flags, flag values, nor taken by positional
+  // members.
+  using Args   = Vector<const char*, N>;
+  using Errors = FlagInfo::BasicErrors<N>;
 
   static auto Parse(int argc, char** argv, bool unknown_are_errors = true) {
     return Parse(argc, const_cast<const char**>(argv), unknown_are_errors);
   }
 
-  template <size_t N>
-  static auto Parse(const char* (&argv)[N], bool unknown_are_errors = true) {
-    return Parse(N, argv, unknown_are_errors);
+  template <size_t Argc>
+  static auto Parse(const char* (&argv)[Argc], bool unknown_are_errors = true) {
+    return Parse(Argc, argv, unknown_are_errors);
   }
 
   static auto Parse(int argc, const char** argv, bool unknown_are_errors = true) {
-    F                        f;
-    std::vector<const char*> args;
-    FlagInfo::Errors         errs;
-    Parse(argc, argv, f, args, errs, unknown_are_errors);
-    return std::make_tuple(std::move(f), std::move(args), std::move(errs));
+    return Parse(argc, argv, F(), unknown_are_errors);
+  }
+
+  // Same as above, but starting from `defaults` instead of a default
+  // constructed `F`, typically a `constexpr` or `constinit` instance.
+  static auto Parse(int argc, char** argv, F defaults, bool unknown_are_errors = true) {
+    return Parse(argc, const_cast<const char**>(argv), std::move(defaults), unknown_are_errors);
+  }
+
+  template <size_t Argc>
+  static auto Parse(const char* (&argv)[Argc], F defaults, bool unknown_are_errors = true) {
+    return Parse(Argc, argv, std::move(defaults), unknown_are_errors);
+  }
+
+  static auto Parse(int argc, const char** argv, F defaults, bool unknown_are_errors = true) {
+    return Parse(argc, argv, std::move(defaults), nullptr, unknown_are_errors);
+  }
+
+  // Same as above, but allocating the arguments, the errors, and the values of
+  // types using a `std::pmr::polymorphic_allocator` from `resource`, e.g. a
+  // `std::pmr::monotonic_buffer_resource` released after the flags.
+  static auto Parse(int argc, char** argv, std::pmr::memory_resource* resource,
+                    bool unknown_are_errors = true) {
+    return Parse(argc, const_cast<const char**>(argv), resource, unknown_are_errors);
+  }
+
+  template <size_t Argc>
+  static auto Parse(const char* (&argv)[Argc], std::pmr::memory_resource* resource,
+                    bool unknown_are_errors = true) {
+    return Parse(Argc, argv, resource, unknown_are_errors);
   }
 
-  static auto Parse(std::vector<const char*>& old_args, FlagInfo::Errors& errs) {
+  static auto Parse(int argc, const char** argv, std::pmr::memory_resource* resource,
+                    bool unknown_are_errors = true) {
+    return Parse(argc, argv, F(), resource, unknown_are_errors);
+  }
+
+  static auto Parse(int argc, const char** argv, F defaults, std::pmr::memory_resource* resource,
+                    bool unknown_are_errors = true) {
+    Args   args(resource);
+    Errors errs(resource);
+    if (resource != nullptr) Rebind(defaults, resource);
+    Parse(argc, argv, defaults, args, errs, unknown_are_errors);
+    return std::make_tuple(std::move(defaults), std::move(args), std::move(errs));
+  }
+
+  // Same as above, but instead of returning the remaining arguments, moves them
+  // after the program name, and sets `argc` to their number plus one, as `main`
+  // would see them, e.g. for another parser. The program name in `argv[0]` is
+  // kept, and not parsed, e.g. as a positional argument. Does not allocate
+  // unless there are more than `N` errors. Errors refer to positions in `argv`.
+  static auto ParseInPlace(int& argc, char** argv, bool unknown_are_errors = true) {
+    return ParseInPlace(argc, argv, F(), unknown_are_errors);
+  }
+
+  static auto ParseInPlace(int& argc, char** argv, F defaults, bool unknown_are_errors = true) {
+    const int   name = argc > 0 ? 1 : 0;  // the program name, kept
+    InPlaceArgs args{.argv = argv + name};
+    Errors      errs;
+    Parse(argc - name, const_cast<const char**>(argv + name), defaults, args, errs,
+          unknown_are_errors);
+    for (auto& error : errs) {
+      if (error.pos >= 0) error.pos += name;
+    }
+    if (name + args.size < argc) argv[name + args.size] = nullptr;  // as `argv[argc]` in `main`
+    argc = name + args.size;
+    return std::make_tuple(std::move(defaults), std::move(errs));
+  }
+
+  // Parses the flags of `F` in `old_args`, and replaces them by the remaining
+  // arguments. Allocations use the resource of `old_args`.
+  template <std::size_t M>
+  static auto Parse(Vector<const char*, M>& old_args, FlagInfo::BasicErrors<M>& errs) {
+    F                      f;
+    Vector<const char*, M> new_args(old_args.resource());
+    if (old_args.resource() != nullptr) Rebind(f, old_args.resource());
+    Parse(static_cast<int>(old_args.size()), old_args.data(), f, new_args, errs);
+    old_args = std::move(new_args);
+    return f;
+  }
+
+  // As above, for arguments in a `std::vector`.
+  template <std::size_t M>
+  static auto Parse(std::vector<const char*>& old_args, FlagInfo::BasicErrors<M>& errs) {
     F                        f;
     std::vector<const char*> new_args;
-    Parse(static_cast<int>(old_args.size()), old_args.data(), f, new_args, errs);
-    new_args.swap(old_args);
+    StdVectorArgs            args{.args = new_args};
+    Parse(static_cast<int>(old_args.size()), old_args.data(), f, args, errs);
+    old_args = std::move(new_args);
     return f;
   }
 
+  // Whether the flag `member` was set by the command line, e.g.
+  // `flags.IsSet(&Flags::port)`, without widening its value as an optional.
+  template <typename M>
+    requires std::is_base_of_v<FlagInfo, M>
+  [[nodiscard]] bool IsSet(M F::*member) const {
+    return reinterpret_cast<const FlagInfo&>(static_cast<const F&>(*this).*member).set;
+  }
+
+  // Calls `visit` with the `FlagInfo` of each flag set by the command line, in
+  // declaration order, e.g. to print the ones not defaulted. Doesn't allocate.
+  template <typename Visit>
+  void ForEachSet(Visit visit) const {
+    const char* f_begin = reinterpret_cast<const char*>(this);
+    const char* f_end   = reinterpret_cast<const char*>(this) + sizeof(F);
+
+    for (const char* pf = f_begin; pf < f_end;) {
+      const auto* info = reinterpret_cast<const FlagInfo*>(pf);
+      if (info->set) visit(*info);
+      pf += info->size;
+    }
+  }
+
+  // Converts the values of the `Lazy` flags, and returns an error for each
+  // invalid one, which `Parse` can't report. Doesn't allocate unless there are
+  // more than `N` errors.
+  [[nodiscard]] Errors Validate() const {
+    const char* f_begin = reinterpret_cast<const char*>(this);
+    const char* f_end   = reinterpret_cast<const char*>(this) + sizeof(F);
+
+    Errors errs;
+    for (const char* pf = f_begin; pf < f_end;) {
+      const auto* info = reinterpret_cast<const FlagInfo*>(pf);
+      if (const char* val = info->validate ? info->validate(*info) : nullptr; val != nullptr) {
+        errs.Add({.pos  = -1,
+                  .arg  = info->name.data(),
+                  .val  = val,
+                  .type = ChoicesType(*info),
+                  .flag = info->name});
+      }
+      pf += info->size;
+    }
+    return errs;
+  }
+
   [[nodiscard]] std::vector<const FlagInfo*> FlagInfos() const {
     const char* f_begin = reinterpret_cast<const char*>(this);
     const char* f_end   = reinterpret_cast<const char*>(this) + sizeof(F);
@@ -192,45 +1423,476 @@ class Flags {
   }
 
  private:
-  static void Parse(int argc, const char** argv, F& f, std::vector<const char*>& args,
-                    FlagInfo::Errors& errs, bool unknown_are_errors = true) {
-    static_assert(sizeof(Flags<F>) == 1);
+  // Upper bound of the number of flags in `F`.
+  static constexpr std::size_t kMaxFlags = sizeof(F) / sizeof(FlagInfo);
+
+  // Size of the table of names, at most half full with a name and an alias
+  // per flag.
+  static constexpr std::size_t kNameSlots = std::bit_ceil(4 * kMaxFlags);
+
+  // The remaining arguments, stored over the ones of `argv` already parsed.
+  struct InPlaceArgs {
+    char** argv = nullptr;
+    int    size = 0;
+
+    bool push_back(const char* arg) {  // NOLINT
+      argv[size++] = const_cast<char*>(arg);
+      return true;
+    }
+  };
+
+  // The arguments left in a `std::vector`, reporting its allocation failures
+  // as the ones of `Args`.
+  struct StdVectorArgs {
+    std::vector<const char*>& args;
+
+    bool push_back(const char* arg) {  // NOLINT
+      return CatchBadAlloc([&] { args.push_back(arg); });
+    }
+  };
+
+  static void Rebind(F& f, std::pmr::memory_resource* resource) {
+    for (char* pf = reinterpret_cast<char*>(&f); pf < reinterpret_cast<char*>(&f) + sizeof(F);) {
+      auto* info = reinterpret_cast<FlagInfo*>(pf);
+      if (info->rebind) info->rebind(*info, resource);
+      pf += info->size;
+    }
+  }
+
+  // The offsets plus one of the flags, by open addressing on the hash of each
+  // of their names and aliases, built once from the first instance parsed.
+  // The names that would fill more than half of the table are left to a
+  // linear scan, for flags with many aliases.
+  struct NameTable {
+    std::array<std::uint32_t, kNameSlots> slots{};
+    std::size_t                           max_size = 0;      // of the names
+    bool                                  overflow = false;  // some names are not in `slots`
+  };
+
+  static const NameTable& GetNameTable(const F& f) {
+    static const auto kNameTable = [&f] {
+      NameTable   table;
+      std::size_t size    = 0;
+      const char* f_begin = reinterpret_cast<const char*>(&f);
+      for (const char* pf = f_begin; pf < f_begin + sizeof(F);) {
+        const auto* info   = reinterpret_cast<const FlagInfo*>(pf);
+        const auto  offset = static_cast<std::uint32_t>(pf - f_begin + 1);
+        info->ForEachName([&](std::string_view name) {
+          table.max_size = std::max(table.max_size, name.size());
+          std::size_t i  = HashName(name) & (kNameSlots - 1);
+          while (table.slots[i] != 0 && table.slots[i] != offset) i = (i + 1) & (kNameSlots - 1);
+          if (table.slots[i] == offset) return;  // e.g. the alias, by default the name
+          if (2 * size == kNameSlots) {
+            table.overflow = true;
+          } else {
+            table.slots[i] = offset, ++size;
+          }
+        });
+        pf += info->size;
+      }
+      return table;
+    }();
+    return kNameTable;
+  }
+
+  // Returns the flag named `prefix` followed by `name`, split so that `name`
+  // is not copied. If several flags have this name, the first one declared
+  // unless some have more aliases than the table holds.
+  static FlagInfo* Find(F& f, std::string_view name, std::string_view prefix = {}) {
+    const NameTable& table = GetNameTable(f);
+    if (prefix.size() + name.size() > table.max_size) return nullptr;
+    const auto is_name = [name, prefix](std::string_view other) {
+      return other.size() == prefix.size() + name.size() && other.starts_with(prefix) &&
+             other.substr(prefix.size()) == name;
+    };
+    char*       f_begin = reinterpret_cast<char*>(&f);
+    std::size_t i       = HashName(name, HashName(prefix)) & (kNameSlots - 1);
+    for (; table.slots[i] != 0; i = (i + 1) & (kNameSlots - 1)) {
+      auto* info = reinterpret_cast<FlagInfo*>(f_begin + table.slots[i] - 1);
+      if (info->AnyName(is_name)) return info;
+    }
+    if (!table.overflow) return nullptr;
+    for (char* pf = f_begin; pf < f_begin + sizeof(F);) {
+      auto* info = reinterpret_cast<FlagInfo*>(pf);
+      if (info->AnyName(is_name)) return info;
+      pf += info->size;
+    }
+    return nullptr;
+  }
+
+  // The offsets plus one of the flags named by a dash and a character, indexed
+  // by this character, built once from the first instance parsed.
+  static const std::array<std::uint32_t, 256>& ShortFlags(const F& f) {
+    static const auto kShortFlags = [&f] {
+      std::array<std::uint32_t, 256> flags{};
+      const char* f_begin = reinterpret_cast<const char*>(&f);
+      for (const char* pf = f_begin; pf < f_begin + sizeof(F);) {
+        const auto* info = reinterpret_cast<const FlagInfo*>(pf);
+        info->ForEachName([&](std::string_view name) {
+          if (name.size() != 2 || info->prefix || info->positional) return;
+          auto& flag = flags[static_cast<unsigned char>(name[1])];
+          if (flag == 0) flag = static_cast<std::uint32_t>(pf - f_begin + 1);
+        });
+        pf += info->size;
+      }
+      return flags;
+    }();
+    return kShortFlags;
+  }
+
+  // The name `-<c>` of `info`, e.g. to report `-p` rather than `-xpabc`.
+  static std::string_view ShortName(const FlagInfo& info, char c) {
+    std::string_view found;
+    info.ForEachName([&](std::string_view name) {
+      if (name.size() == 2 && name[1] == c && !info.prefix) found = name;
+    });
+    return found;
+  }
+
+  // Returns the flag without a value named `--<name>` for `--no-<name>`, with
+  // a value resetting it.
+  static FlagInfo* Negated(F& f, std::string_view arg, const char*& val, int& next) {
+    FlagInfo* info = Find(f, arg.substr(5), "--");
+    if (info == nullptr || info->has_value) return nullptr;
+    val = "0", next = 0;
+    return info;
+  }
+
+  // The prefix flags, in lists indexed by the character after the dash, built
+  // once from the first instance parsed.
+  struct PrefixFlags {
+    std::array<std::uint32_t, 256>       first{};    // index plus one of the first flag
+    std::array<std::uint32_t, kMaxFlags> next{};     // index plus one of the next flag
+    std::array<std::uint32_t, kMaxFlags> offsets{};  // of the flags
+  };
+
+  static const PrefixFlags& GetPrefixFlags(const F& f) {
+    static const auto kPrefixFlags = [&f] {
+      PrefixFlags flags;
+      std::uint32_t size    = 0;
+      const char*   f_begin = reinterpret_cast<const char*>(&f);
+      for (const char* pf = f_begin; pf < f_begin + sizeof(F);) {
+        const auto* info = reinterpret_cast<const FlagInfo*>(pf);
+        if (info->prefix && info->name.size() > 1) {
+          auto& first         = flags.first[static_cast<unsigned char>(info->name[1])];
+          flags.offsets[size] = static_cast<std::uint32_t>(pf - f_begin);
+          flags.next[size]    = first;
+          first               = ++size;
+        }
+        pf += info->size;
+      }
+      return flags;
+    }();
+    return kPrefixFlags;
+  }
+
+  // Returns the prefix flag with the longest name starting `arg`, if any, and
+  // points `val` to the rest of `arg`.
+  static FlagInfo* Prefix(F& f, std::string_view arg, const char*& val, int& next) {
+    const auto& flags = GetPrefixFlags(f);
+    FlagInfo*   found = nullptr;
+    for (std::uint32_t i = flags.first[static_cast<unsigned char>(arg[1])]; i != 0;) {
+      auto* info = reinterpret_cast<FlagInfo*>(reinterpret_cast<char*>(&f) + flags.offsets[i - 1]);
+      if (arg.starts_with(info->name) && (!found || info->name.size() > found->name.size())) {
+        found = info;
+      }
+      i = flags.next[i - 1];
+    }
+    if (found != nullptr) val = arg.data() + found->name.size(), next = 0;
+    return found;
+  }
+
+  // The positional members, in declaration order, built once from the first
+  // instance parsed. They end at the first one taking all the remaining
+  // arguments, e.g. `Rest`: a later one would never be filled.
+  struct PositionalFlags {
+    std::array<std::uint32_t, kMaxFlags> offsets{};
+    std::uint32_t                        size      = 0;
+    std::uint32_t                        misplaced = 0;  // offset plus one of the first later one
+  };
+
+  static const PositionalFlags& GetPositionalFlags(const F& f) {
+    static const auto kPositionalFlags = [&f] {
+      PositionalFlags flags;
+      const char*     f_begin = reinterpret_cast<const char*>(&f);
+      bool            rest    = false;  // whether the last one takes the remaining arguments
+      for (const char* pf = f_begin; pf < f_begin + sizeof(F);) {
+        const auto* info   = reinterpret_cast<const FlagInfo*>(pf);
+        const auto  offset = static_cast<std::uint32_t>(pf - f_begin);
+        if (info->positional && rest) {
+          if (flags.misplaced == 0) flags.misplaced = offset + 1;
+        } else if (info->positional) {
+          flags.offsets[flags.size++] = offset;
+          rest                        = info->max_values > 1;
+        }
+        pf += info->size;
+      }
+      return flags;
+    }();
+    return kPositionalFlags;
+  }
+
+  // For clustered short flags, e.g. `-abc`, sets all the flags but the last,
+  // and returns it. Its value is either attached, e.g. `-p8080`, or `val`.
+  // Returns null without setting any flag if a character is not a flag.
+  static FlagInfo* Cluster(F& f, std::string_view arg, const char*& val, int& next) {
+    const auto& flags = ShortFlags(f);
+    const auto  at    = [&](char c) -> FlagInfo* {
+      const std::uint32_t offset = flags[static_cast<unsigned char>(c)];
+      if (offset == 0) return nullptr;
+      return reinterpret_cast<FlagInfo*>(reinterpret_cast<char*>(&f) + offset - 1);
+    };
+    std::size_t end = 1;  // of the flags, before the value
+    while (end < arg.size()) {
+      const FlagInfo* info = at(arg[end++]);
+      if (info == nullptr) return nullptr;
+      if (info->has_value) break;
+    }
+    for (std::size_t i = 1; i + 1 < end; ++i) {
+      FlagInfo* info = at(arg[i]);
+      info->parse(*info, nullptr);
+      info->fallback = nullptr;
+      info->set      = true;
+    }
+    if (end < arg.size()) val = arg.data() + end, next = 0;
+    return at(arg[end - 1]);
+  }
+
+  // Counts the occurrences of the flags having a `FlagInfo::reserve` function
+  // in a first pass, so that their values are not reallocated while parsing.
+  // Flags with several values reserve them in `ParseValues` instead.
+  static void Reserve(int argc, const char** argv, F& f) {
+    std::array<FlagInfo*, kMaxFlags>   repeated{};
+    std::array<std::size_t, kMaxFlags> counts{};
+    std::size_t                        size = 0;
+    for (char* pf = reinterpret_cast<char*>(&f); pf < reinterpret_cast<char*>(&f) + sizeof(F);) {
+      auto* info = reinterpret_cast<FlagInfo*>(pf);
+      if (info->reserve && info->max_values == 1) repeated[size++] = info;
+      pf += info->size;
+    }
+    if (size == 0) return;
+    for (int pos = 0; pos < argc; ++pos) {
+      if (argv[pos][0] != '-') continue;
+      const std::string_view name = argv[pos];
+      if (name == "--") break;
+      const FlagInfo* found = Find(f, name.substr(0, name.find('=')));
+      for (std::size_t i = 0; i < size; ++i) {
+        const FlagInfo& info = *repeated[i];
+        if (&info == found || (info.prefix && name.starts_with(info.name))) ++counts[i];
+      }
+    }
+    for (std::size_t i = 0; i < size; ++i) {
+      if (counts[i] > 1) repeated[i]->reserve(*repeated[i], counts[i]);
+    }
+  }
+
+  // Only the command line being parsed counts for the exclusive groups, not
+  // the one that produced the defaults.
+  static void ResetGroups(F& f) {
+    for (char* pf = reinterpret_cast<char*>(&f); pf < reinterpret_cast<char*>(&f) + sizeof(F);) {
+      auto* info    = reinterpret_cast<FlagInfo*>(pf);
+      info->grouped = false;
+      pf += info->size;
+    }
+  }
+
+  template <typename A, typename E>
+  static void Parse(int argc, const char** argv, F& f, A& args, E& errs,
+                    bool unknown_are_errors = true) {
+    static_assert(sizeof(Flags) == 1);
     static_assert(sizeof(F) > 1);
 
     static constexpr std::string_view kDashDash = "--";
 
-    const char* f_begin = reinterpret_cast<const char*>(&f);
-    const char* f_end   = reinterpret_cast<const char*>(&f) + sizeof(F);
-    int         pos     = 0;
+    Reserve(argc, argv, f);
+    ResetGroups(f);
+
+    const auto&   positionals = GetPositionalFlags(f);
+    std::uint32_t positional  = 0;  // index of the next positional member
+    char*         f_begin     = reinterpret_cast<char*>(&f);
+    char*         f_end       = reinterpret_cast<char*>(&f) + sizeof(F);
+    int           pos         = 0;
     while (pos < argc) {
       const char*                    arg    = argv[pos];
+      const std::string_view         name   = arg;
       const char*                    val    = pos + 1 < argc ? argv[pos + 1] : nullptr;
+      int                            next   = 1;  // arguments holding the value
       int                            parsed = 0;
       std::optional<FlagInfo::Error> error  = std::nullopt;
-      if (kDashDash == arg) break;
-      for (const char* pf = f_begin; !parsed && pf < f_end;) {
-        const auto* info = reinterpret_cast<const FlagInfo*>(pf);
-        switch (info->parse(arg, val)) {
-          using enum FlagInfo::ParseStatus;
-          case kNoneParsed:   break;
-          case kOneParsed:    parsed = 1; break;
-          case kTwoParsed:    parsed = 2; break;
-          case kParseMissing: parsed = 1, error = {.pos = pos, .arg = arg, .val = nullptr}; break;
-          case kParseFailure: parsed = 2, error = {.pos = pos, .arg = arg, .val = val}; break;
+      std::string_view               flag;  // the flag's name, if `arg` also has a value
+      if (kDashDash == name) break;
+      if (val != nullptr && val[0] == '-') val = nullptr;  // a flag, not a value
+      FlagInfo* info = arg[0] == '-' ? Find(f, name) : nullptr;
+      if (const std::size_t equal = name.find('='); !info && equal != name.npos && arg[0] == '-') {
+        info = Find(f, name.substr(0, equal));  // `name=value`, split without copying
+        if (info != nullptr && info->prefix) info = nullptr;  // `-I=dir` has the value `=dir`
+        if (info != nullptr) val = arg + equal + 1, next = 0, flag = name.substr(0, equal);
+      }
+      if (!info && name.starts_with("--no-")) info = Negated(f, name, val, next);
+      if (!info && name.size() > 2 && name[0] == '-') {
+        info = Prefix(f, name, val, next);
+        if (info != nullptr) flag = info->name;
+      }
+      if (!info && name.size() > 2 && name[0] == '-' && name[1] != '-') {
+        info = Cluster(f, name, val, next);
+        if (info != nullptr) flag = ShortName(*info, next == 0 ? val[-1] : name.back());
+      }
+      if (info != nullptr) {
+        if (!info->has_value && next != 0) val = nullptr;
+        if (info->max_values > 1 && next != 0) {
+          parsed = ParseValues(f, argc, argv, pos, *info, errs);
+        } else {
+          switch (info->parse(*info, val)) {
+            using enum FlagInfo::ParseStatus;
+            case kNoneParsed:   break;
+            case kOneParsed:    parsed = 1; break;
+            case kTwoParsed:    parsed = 1 + next; break;
+            case kParseMissing:
+              parsed = 1, error = {.pos = pos, .arg = arg, .val = nullptr, .flag = flag};
+              break;
+            case kParseFailure:
+              parsed = 1 + next;
+              error  = {
+                   .pos = pos, .arg = arg, .val = val, .type = ChoicesType(*info), .flag = flag};
+              break;
+            case kParseNoMemory:
+              parsed = 1 + next;
+              error  = {.pos = pos, .arg = arg, .val = FlagInfo::Error::kNoMemory};
+              break;
+          }
         }
-        pf += info->size;
+        info->fallback = nullptr;
+        info->set      = true;
       }
-      if (error.has_value()) errs.push_back(*error);
-      if (parsed == 0) {
+      if (error.has_value()) errs.Add(*error);
+      const bool value = arg[0] != '-' || IsNegative(f, name);  // for a positional member
+      if (parsed == 0 && !(value && AddPositional(f, positionals, positional, errs, pos, arg))) {
         if (arg[0] == '-' && unknown_are_errors) {
-          errs.push_back({.pos = pos, .arg = arg});
+          errs.Add({.pos = pos, .arg = arg});
         } else {
-          args.push_back(arg);
+          AddArg(args, errs, pos, arg);
         }
       }
       pos += std::max(1, parsed);
     }
-    while (++pos < argc) args.push_back(argv[pos]);
+    while (++pos < argc) {
+      if (!AddPositional(f, positionals, positional, errs, pos, argv[pos])) {
+        AddArg(args, errs, pos, argv[pos]);
+      }
+    }
+    if (positionals.misplaced != 0) {
+      const auto* info = reinterpret_cast<FlagInfo*>(f_begin + positionals.misplaced - 1);
+      errs.Add({.pos = -1, .arg = info->name.data(), .val = FlagInfo::Error::kMisplaced});
+    }
+    std::uint64_t groups = 0;  // one bit per exclusive group with a flag counting for it
+    for (char* pf = f_begin; pf < f_end;) {
+      auto* info = reinterpret_cast<FlagInfo*>(pf);
+      if (info->fallback && !std::exchange(info->fallback, nullptr)(*info)) {
+        errs.Add({.pos = -1, .arg = info->name.data(), .val = FlagInfo::Error::kNoMemory});
+      }
+      if (info->required && !info->set) {
+        errs.Add({.pos = -1, .arg = info->name.data(), .val = FlagInfo::Error::kRequired});
+      }
+      if (info->group != 0 && info->grouped) {
+        const std::uint64_t group = std::uint64_t{1} << (info->group - 1);
+        if ((groups & group) != 0) {
+          errs.Add({.pos = -1, .arg = info->name.data(), .val = FirstSet(f, info->group)});
+        }
+        groups |= group;
+      }
+      pf += info->size;
+    }
+  }
+
+  // Parses the values following the flag at `pos`, which may have several, up
+  // to the next flag or `--`. Returns the number of arguments parsed, including
+  // the flag.
+  template <typename E>
+  static int ParseValues(F& f, int argc, const char** argv, int pos, FlagInfo& info, E& errs) {
+    int count = 0;  // look ahead, so that the values are not reallocated
+    while (count < info.max_values && pos + 1 + count < argc && !IsFlag(f, argv[pos + 1 + count])) {
+      ++count;
+    }
+    if (count < info.min_values) errs.Add({.pos = pos, .arg = argv[pos], .val = nullptr});
+    if (count > 1) info.reserve(info, count);
+    for (int i = pos + 1; i <= pos + count; ++i) {
+      switch (info.parse(info, argv[i])) {
+        using enum FlagInfo::ParseStatus;
+        case kParseFailure:
+          errs.Add({.pos = pos, .arg = argv[pos], .val = argv[i], .type = ChoicesType(info)});
+          break;
+        case kParseNoMemory:
+          errs.Add({.pos = pos, .arg = argv[pos], .val = FlagInfo::Error::kNoMemory});
+          break;
+        default: break;
+      }
+    }
+    return 1 + count;
+  }
+
+  // Whether `arg` is `--` or would be parsed as a flag of `F`, to end the
+  // values of a flag with several values, but not at a value such as `-1`.
+  static bool IsFlag(F& f, std::string_view arg) {
+    if (arg.size() < 2 || arg[0] != '-') return false;
+    if (arg == "--" || Find(f, arg.substr(0, arg.find('='))) != nullptr) return true;
+    const char* val  = nullptr;
+    int         next = 0;
+    if (arg.starts_with("--no-") && Negated(f, arg, val, next) != nullptr) return true;
+    if (arg.size() > 2 && Prefix(f, arg, val, next) != nullptr) return true;
+    return arg[1] != '-' && ShortFlags(f)[static_cast<unsigned char>(arg[1])] != 0;
+  }
+
+  // Whether `arg`, starting with `-`, is a negative number rather than a flag,
+  // e.g. `-3` or `-.5`, for a positional member, as for the values of a flag
+  // with several values.
+  static bool IsNegative(F& f, std::string_view arg) {
+    const bool number = arg.size() > 1 && (std::isdigit(static_cast<unsigned char>(arg[1])) != 0 ||
+                                           arg[1] == '.');
+    return number && !IsFlag(f, arg);
+  }
+
+  // The type of the flag, to report invalid values, if it has choices.
+  static const FlagInfo::Type* ChoicesType(const FlagInfo& info) {
+    return info.type->choices.empty() ? nullptr : info.type;
+  }
+
+  // The name of the first flag counting for the exclusive group `group`.
+  static const char* FirstSet(const F& f, std::uint8_t group) {
+    for (const char* pf = reinterpret_cast<const char*>(&f);;) {
+      const auto* info = reinterpret_cast<const FlagInfo*>(pf);
+      if (info->group == group && info->grouped) return info->name.data();
+      pf += info->size;
+    }
+  }
+
+  // Converts `arg` into the positional member at index `positional`, and moves
+  // to the next one unless it takes several arguments. Returns false if there
+  // is no positional member left.
+  template <typename E>
+  static bool AddPositional(F& f, const PositionalFlags& positionals, std::uint32_t& positional,
+                            E& errs, int pos, const char* arg) {
+    if (positional >= positionals.size) return false;
+    auto* info = reinterpret_cast<FlagInfo*>(reinterpret_cast<char*>(&f) +
+                                             positionals.offsets[positional]);
+    if (info->max_values == 1) ++positional;
+    switch (info->parse(*info, arg)) {
+      using enum FlagInfo::ParseStatus;
+      case kParseFailure:
+        errs.Add({.pos = pos, .arg = arg, .val = arg, .type = ChoicesType(*info)});
+        break;
+      case kParseNoMemory:
+        errs.Add({.pos = pos, .arg = arg, .val = FlagInfo::Error::kNoMemory});
+        break;
+      default: break;
+    }
+    info->fallback = nullptr;
+    info->set      = true;
+    return true;
+  }
+
+  template <typename A, typename E>
+  static void AddArg(A& args, E& errs, int pos, const char* arg) {
+    if (!args.push_back(arg)) errs.Add({.pos = pos, .arg = arg, .val = FlagInfo::Error::kNoMemory});
   }
 };
 
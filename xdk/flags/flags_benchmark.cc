@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "xdk/flags/flags.h"
+#include "xdk/flags/flags_chrono.h"
+
+namespace xdk {
+namespace {
+
+template <typename T>
+void BM_ParseValue(benchmark::State& state, const char* arg) {
+  T value{};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ParseValue(arg, value));
+    benchmark::DoNotOptimize(value);
+  }
+}
+auto* const BM_ParseInt      = BM_ParseValue<int>;
+auto* const BM_ParseInt64    = BM_ParseValue<long long>;
+auto* const BM_ParseDouble   = BM_ParseValue<double>;
+auto* const BM_ParseString   = BM_ParseValue<std::string>;
+auto* const BM_ParseDuration = BM_ParseValue<std::chrono::milliseconds>;
+auto* const BM_ParseByteSize = BM_ParseValue<ByteSize>;
+BENCHMARK_CAPTURE(BM_ParseInt, positive, "123456");
+BENCHMARK_CAPTURE(BM_ParseInt64, negative, "-1234567890123");
+BENCHMARK_CAPTURE(BM_ParseDouble, exponent, "3.14159e-3");
+BENCHMARK_CAPTURE(BM_ParseString, path, "some/path/to/a/file");
+BENCHMARK_CAPTURE(BM_ParseDuration, milliseconds, "250ms");
+BENCHMARK_CAPTURE(BM_ParseDuration, minutes, "90min");
+BENCHMARK_CAPTURE(BM_ParseByteSize, binary, "4GiB");
+BENCHMARK_CAPTURE(BM_ParseByteSize, decimal, "500MB");
+
+// Copied rather than moved when a vector grows, as it has no move constructor.
+struct Path {
+  Path()                       = default;
+  Path(const Path&)            = default;
+  Path& operator=(const Path&) = default;
+  ~Path()                      = default;
+
+  std::string value;
+};
+
+bool ParseValue(const char* arg, Path& path) {
+  path.value = arg;
+  return true;
+}
+
+// Parses `--tag <value>` repeated `state.range(0)` times.
+template <typename T>
+void BM_RepeatedFlag(benchmark::State& state) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--tag", std::vector<T>> tags;
+    Flag<"--other", int>          other;
+  };
+  const std::string        value(32, 'x');  // not using the small string optimization
+  std::vector<const char*> argv;
+  for (int i = 0; i < state.range(0); ++i) {
+    argv.push_back("--tag");
+    argv.push_back(value.c_str());
+  }
+  for (auto _ : state) {
+    auto [flags, args, errors] = TestFlags::Parse(static_cast<int>(argv.size()), argv.data());
+    benchmark::DoNotOptimize(flags.tags->data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RepeatedFlag<std::string>)->Arg(10)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+BENCHMARK(BM_RepeatedFlag<Path>)->Arg(10)->Arg(1'000)->Arg(10'000)->Arg(100'000);
+
+// Parses a compiler command line of 20k arguments, mostly `-I<path>` and `-D<macro>`.
+void BM_CompileLine(benchmark::State& state) {
+  struct CompilerFlags : Flags<CompilerFlags> {
+    PrefixFlag<"-I", std::vector<std::string_view>> includes;
+    PrefixFlag<"-D", std::vector<std::string_view>> defines;
+    PrefixFlag<"-O", int>                            optimize;
+    Flag<"-o", std::string_view>                     output;
+    Flag<"-c", bool>                                 compile;
+  };
+  std::vector<std::string> strings;
+  for (int i = 0; i < 10'000; ++i) {
+    strings.push_back("-I/usr/include/project/module" + std::to_string(i));
+  }
+  for (int i = 0; i < 9'995; ++i) {
+    strings.push_back("-DPROJECT_MACRO_" + std::to_string(i) + "=1");
+  }
+  for (const char* arg : {"-O2", "-c", "-o", "main.o", "main.cc"}) strings.emplace_back(arg);
+  std::vector<const char*> argv;
+  for (const auto& str : strings) argv.push_back(str.c_str());
+  for (auto _ : state) {
+    auto [flags, args, errors] = CompilerFlags::Parse(static_cast<int>(argv.size()), argv.data());
+    benchmark::DoNotOptimize(flags.includes->data());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(argv.size()));
+}
+BENCHMARK(BM_CompileLine);
+
+}  // namespace
+}  // namespace xdk
+
+BENCHMARK_MAIN();
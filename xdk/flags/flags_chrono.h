@@ -0,0 +1,99 @@
+#ifndef XDK_FLAGS_FLAGS_CHRONO_H_
+#define XDK_FLAGS_FLAGS_CHRONO_H_
+
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "xdk/flags/flags.h"
+
+namespace xdk {
+
+// Multiplies `value` by `factor` in place, unless it overflows.
+constexpr bool MultiplyChecked(std::int64_t& value, std::int64_t factor) {
+  if (value > std::numeric_limits<std::int64_t>::max() / factor ||
+      value < std::numeric_limits<std::int64_t>::min() / factor) {
+    return false;
+  }
+  value *= factor;
+  return true;
+}
+
+// A duration unit of `num / den` seconds in ticks of `Period`, as `num / den`,
+// or 0 if it overflows.
+template <typename Period>
+struct DurationUnit {
+  constexpr DurationUnit(std::int64_t unit_num, std::int64_t unit_den) {
+    const std::int64_t num_gcd = std::gcd(unit_num, static_cast<std::int64_t>(Period::num));
+    const std::int64_t den_gcd = std::gcd(unit_den, static_cast<std::int64_t>(Period::den));
+    num = unit_num / num_gcd, den = unit_den / den_gcd;
+    if (!MultiplyChecked(num, Period::den / den_gcd)) num = 0;
+    if (!MultiplyChecked(den, Period::num / num_gcd)) num = 0;
+  }
+
+  std::int64_t num = 0;
+  std::int64_t den = 1;
+};
+
+// Parses a number followed by a unit among `ns`, `us`, `ms`, `s`, `m` or `min`,
+// `h` and `d`, e.g. `250ms`. The unit may only be omitted for 0. For integral
+// representations, the value must be a whole number of ticks, e.g. `2000us`
+// is valid for milliseconds but not `1500us`. For floating-point ones, it must
+// be finite.
+template <typename Rep, typename Period>
+struct ValueParser<std::chrono::duration<Rep, Period>> {
+  static bool Parse(const char* arg, std::chrono::duration<Rep, Period>& value) {
+    using Number = std::conditional_t<std::is_floating_point_v<Rep>, double, std::int64_t>;
+    const char* end          = arg + std::char_traits<char>::length(arg);
+    Number      count        = 0;
+    const auto [suffix, err] = FromChars(arg, end, count);
+    if (err != std::errc() || suffix == arg) return false;
+    using Unit = DurationUnit<Period>;
+    static constexpr std::array<Unit, 7> kUnits = {
+        Unit(1, 1'000'000'000),  // ns
+        Unit(1, 1'000'000),      // us
+        Unit(1, 1'000),          // ms
+        Unit(1, 1),              // s
+        Unit(60, 1),             // m or min
+        Unit(3'600, 1),          // h
+        Unit(86'400, 1),         // d
+    };
+    const std::string_view name(suffix, end - suffix);
+    int                    index = -1;  // in `kUnits`
+    switch (name.empty() ? 0 : name[0]) {
+      case 0:   index = count == 0 ? 3 : -1; break;
+      case 'n': index = name == "ns" ? 0 : -1; break;
+      case 'u': index = name == "us" ? 1 : -1; break;
+      case 'm': index = name == "ms" ? 2 : name == "m" || name == "min" ? 4 : -1; break;
+      case 's': index = name == "s" ? 3 : -1; break;
+      case 'h': index = name == "h" ? 5 : -1; break;
+      case 'd': index = name == "d" ? 6 : -1; break;
+      default:  break;
+    }
+    if (index < 0 || kUnits[index].num == 0) return false;  // unknown, or too large for `Period`
+    const Unit unit = kUnits[index];
+    if constexpr (std::is_floating_point_v<Rep>) {
+      const auto ticks = static_cast<Rep>(count * unit.num / unit.den);
+      if (!std::isfinite(ticks)) return false;  // `inf`, `nan`, or out of range of `Rep`
+      value = std::chrono::duration<Rep, Period>(ticks);
+    } else {
+      if (count % unit.den != 0) return false;  // not a whole number of ticks
+      count /= unit.den;
+      if (!MultiplyChecked(count, unit.num) || !std::in_range<Rep>(count)) return false;
+      value = std::chrono::duration<Rep, Period>(static_cast<Rep>(count));
+    }
+    return true;
+  }
+};
+
+}  // namespace xdk
+
+#endif  // XDK_FLAGS_FLAGS_CHRONO_H_
@@ -0,0 +1,99 @@
+#ifndef XDK_FLAGS_FLAGS_INTERN_H_
+#define XDK_FLAGS_FLAGS_INTERN_H_
+
+#include <cstddef>
+#include <cstring>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "xdk/flags/flags.h"
+
+namespace xdk {
+
+// Stores one copy of each distinct string in an arena, so that memory scales
+// with the number of distinct values. Views returned by `Intern` stay valid as
+// long as the pool. It is not thread-safe.
+class StringPool {
+ public:
+  explicit StringPool(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : arena_(resource), views_(resource) {}
+
+  StringPool(const StringPool&)            = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // Copies `str` into the arena on its first occurrence.
+  std::string_view Intern(std::string_view str) {
+    if (auto it = views_.find(str); it != views_.end()) return *it;
+    auto* data = static_cast<char*>(arena_.allocate(str.size(), 1));
+    std::memcpy(data, str.data(), str.size());
+    return *views_.emplace(data, str.size()).first;
+  }
+
+  // The number of distinct strings.
+  [[nodiscard]] std::size_t size() const {
+    return views_.size();
+  }
+
+ private:
+  std::pmr::monotonic_buffer_resource       arena_;
+  std::pmr::unordered_set<std::string_view> views_;
+};
+
+// The values of a repeated flag, interned in a `StringPool` that may be shared
+// by several parses, e.g. `Flag<"--tag", InternedStrings> tags{&pool}`.
+// Without a pool, values point into `argv`.
+class InternedStrings {
+ public:
+  using value_type     = std::string_view;
+  using allocator_type = std::pmr::polymorphic_allocator<>;
+  using const_iterator = std::pmr::vector<std::string_view>::const_iterator;
+
+  explicit InternedStrings(StringPool* pool = nullptr, const allocator_type& alloc = {})
+      : pool_(pool), values_(alloc) {}
+  InternedStrings(const InternedStrings& other, const allocator_type& alloc)
+      : pool_(other.pool_), values_(other.values_, alloc) {}
+  InternedStrings(InternedStrings&& other, const allocator_type& alloc)
+      : pool_(other.pool_), values_(std::move(other.values_), alloc) {}
+
+  InternedStrings(const InternedStrings&)            = default;
+  InternedStrings(InternedStrings&&)                 = default;
+  InternedStrings& operator=(const InternedStrings&) = default;
+  InternedStrings& operator=(InternedStrings&&)      = default;
+  ~InternedStrings()                                 = default;
+
+  [[nodiscard]] bool empty() const {
+    return values_.empty();
+  }
+  [[nodiscard]] std::size_t size() const {
+    return values_.size();
+  }
+  const_iterator begin() const {
+    return values_.begin();
+  }
+  const_iterator end() const {
+    return values_.end();
+  }
+  std::string_view operator[](std::size_t i) const {
+    return values_[i];
+  }
+
+  void push_back(std::string_view value) {  // NOLINT
+    values_.push_back(pool_ ? pool_->Intern(value) : value);
+  }
+
+ private:
+  StringPool*                        pool_;
+  std::pmr::vector<std::string_view> values_;
+};
+
+inline bool ParseValue(const char* arg, InternedStrings& value) {
+  value.push_back(arg);
+  return true;
+}
+
+}  // namespace xdk
+
+#endif  // XDK_FLAGS_FLAGS_INTERN_H_
@@ -0,0 +1,31 @@
+#ifndef XDK_FLAGS_FLAGS_STREAM_H_
+#define XDK_FLAGS_FLAGS_STREAM_H_
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <type_traits>
+#include <utility>
+
+#include "xdk/flags/flags.h"
+
+namespace xdk {
+
+template <typename T>
+struct ValueParser<T, std::void_t<decltype(std::declval<std::istream&>() >> std::declval<T&>())>> {
+  static bool Parse(const char* arg, T& value) {
+    std::istringstream stream(arg);
+    stream >> value;
+    return !stream.fail();
+  }
+};
+
+template <std::size_t N>
+std::ostream& operator<<(std::ostream& os, const FlagInfo::BasicErrors<N>& errors) {
+  return os << errors.ToString();
+}
+
+}  // namespace xdk
+
+#endif  // XDK_FLAGS_FLAGS_STREAM_H_
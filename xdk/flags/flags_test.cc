@@ -1,19 +1,62 @@
 #include "xdk/flags/flags.h"
 
 #include <array>
+#include <cstdlib>
 #include <iomanip>
 #include <iostream>
+#include <memory_resource>
+#include <new>
 #include <string>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "xdk/flags/flags_chrono.h"
+#include "xdk/flags/flags_intern.h"
+#include "xdk/flags/flags_stream.h"
+
+// While set, `new (std::nothrow)` fails, to test reporting of allocation failures.
+bool fail_nothrow_new = false;  // NOLINT
+// Number of calls to `new`, to test that parsing doesn't allocate.
+int allocations = 0;  // NOLINT
+
+// GCC warns where these get inlined, as if `free` could receive memory from
+// the default `new`, although all of them are replaced together.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size, const std::nothrow_t& /*unused*/) noexcept {
+  ++allocations;
+  return fail_nothrow_new ? nullptr : std::malloc(size);  // NOLINT
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);  // NOLINT
+}
+
+void operator delete(void* ptr, std::size_t /*unused*/) noexcept {
+  std::free(ptr);  // NOLINT
+}
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  void* ptr = std::malloc(size);  // NOLINT
+  if (ptr == nullptr) std::abort();
+  return ptr;
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
 
 namespace xdk {
 std::ostream& operator<<(std::ostream& os, const FlagInfo::Error& error) {
   os << "FlagInfo::Error{.pos=" << error.pos;
   if (error.arg != nullptr) os << ", .arg=" << std::quoted(error.arg);
   if (error.val != nullptr) os << ", .val=" << std::quoted(error.val);
+  if (!error.flag.empty()) os << ", .flag=" << error.flag;
   return os << "}";
 }
 
@@ -175,6 +218,19 @@ TEST(FlagsTest, AdvancedDemo) {
 
     ASSERT_THAT(args, ElementsAre("value"));
   }
+  // Or from a `std::vector`, with a copy of the errors kept aside.
+  {
+    std::vector<const char*> args(std::begin(argv), std::end(argv));
+    FlagInfo::Errors         errors;
+    auto                     flags = TestFlags::Parse(args, errors);
+    FlagInfo::Errors         copy  = errors;
+    ASSERT_THAT(flags.port, Eq(8080));
+    ASSERT_THAT(args, ElementsAre("value"));
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 0, .arg = "-v"},
+                                    FlagInfo::Error{.pos = 3, .arg = "--unknown"}));
+    ASSERT_THAT(copy, ElementsAre(FlagInfo::Error{.pos = 0, .arg = "-v"},
+                                  FlagInfo::Error{.pos = 3, .arg = "--unknown"}));
+  }
 }
 
 TEST(FlagsTest, ErrorIndex) {
@@ -262,5 +318,1018 @@ TEST(FlagsTest, SubcommandExample) {
   }
 }
 
+// Counts how many times a value was streamed in.
+struct Expensive {
+  static inline int conversions = 0;
+
+  int value = 0;
+
+  friend std::istream& operator>>(std::istream& is, Expensive& e) {
+    ++conversions;
+    return is >> e.value;
+  }
+};
+
+TEST(FlagsTest, LazyValues) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--unused", Lazy<Expensive>> unused;
+    Flag<"--used", Lazy<Expensive>>   used;
+    Flag<"--center", Lazy<Point>>     center{1, 2};
+    Flag<"--bad", Lazy<int>>          bad{7};
+  };
+
+  const char* argv[] = {"--unused", "1", "--used", "2", "--used", "3", "--bad", "x"};
+
+  Expensive::conversions     = 0;
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(Expensive::conversions, Eq(0));
+
+  ASSERT_THAT(flags.used->value().value, Eq(3));
+  ASSERT_THAT(flags.used.value->value, Eq(3));
+  ASSERT_THAT(Expensive::conversions, Eq(1));
+
+  ASSERT_TRUE(flags.unused->Validate());
+  ASSERT_THAT(Expensive::conversions, Eq(2));
+
+  ASSERT_TRUE(flags.center->Validate());
+  ASSERT_THAT(flags.center.value->x, Eq(1));
+
+  ASSERT_FALSE(flags.bad->Validate());
+}
+
+TEST(FlagsTest, LazyCopies) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--used", Lazy<Expensive>>         used;
+    Flag<"--later", Lazy<Expensive>>        later;
+    Flag<"--list", Lazy<std::vector<int>>> list;
+  };
+
+  const char* argv[] = {"--used", "1", "--later", "2", "--list", "3"};
+
+  Expensive::conversions     = 0;
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.used->value().value, Eq(1));
+  ASSERT_THAT(flags.list->value(), ElementsAre(3));
+
+  TestFlags copy = flags;
+  ASSERT_THAT(copy.used->value().value, Eq(1));  // already converted
+  ASSERT_THAT(Expensive::conversions, Eq(1));
+  ASSERT_THAT(copy.later->value().value, Eq(2));  // converted by the copy only
+  ASSERT_THAT(Expensive::conversions, Eq(2));
+  ASSERT_THAT(flags.later->value().value, Eq(2));
+  ASSERT_THAT(Expensive::conversions, Eq(3));
+  ASSERT_THAT(copy.list->value(), ElementsAre(3));  // not converted again
+
+  TestFlags assigned;
+  assigned = flags;
+  ASSERT_THAT(assigned.list->value(), ElementsAre(3));
+  assigned = std::get<0>(TestFlags::Parse(argv));
+  ASSERT_THAT(assigned.list->value(), ElementsAre(3));
+}
+
+TEST(FlagsTest, ValidateLazyFlags) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--size", Lazy<int>>     size{1};
+    Flag<"--ratio", Lazy<double>> ratio;
+    Flag<"--name", std::string>   name;
+    Flag<"--mode", Lazy<int>>     mode;
+  };
+
+  const char* argv[]         = {"--size", "x", "--ratio", "0.5", "--name", "n", "--mode", "y\""};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+
+  const auto infos = flags.FlagInfos();
+  ASSERT_THAT(flags.Validate(), ElementsAre(FlagInfo::Error{.pos  = -1,
+                                                            .arg  = infos[0]->name.data(),
+                                                            .val  = argv[1],
+                                                            .flag = "--size"},
+                                            FlagInfo::Error{.pos  = -1,
+                                                            .arg  = infos[3]->name.data(),
+                                                            .val  = argv[7],
+                                                            .flag = "--mode"}));
+  ASSERT_THAT(flags.Validate().ToString(),
+              StrEq("\nInvalid value \"x\" for flag `--size`\n"
+                    "Invalid value \"y\\\"\" for flag `--mode`\n"));
+  ASSERT_THAT(flags.ratio->value(), Eq(0.5));
+  ASSERT_THAT(TestFlags().Validate(), IsEmpty());
+}
+
+std::vector<int> BuildTable() {
+  static int calls = 0;
+  return {++calls, 2, 3};
+}
+
+TEST(FlagsTest, LazyDefaults) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--table", std::vector<int>> table{Default<BuildTable>{}};
+    Flag<"--name", std::string>       name{Default<[] { return std::string("lambda"); }>{}};
+  };
+  {
+    const char* argv[]         = {"--table", "7"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.table.value, ElementsAre(7));
+    ASSERT_THAT(flags.name, StrEq("lambda"));
+  }
+  {
+    const char* argv[]         = {"--name", "given"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.table.value, ElementsAre(1, 2, 3));  // first call of `BuildTable`
+    ASSERT_THAT(flags.name, StrEq("given"));
+  }
+}
+
+struct ServerFlags : Flags<ServerFlags> {
+  Flag<"--port", int, "-p"> port{8080};
+  Flag<"--verbose", bool>   verbose;
+  Flag<"--ratio", double>   ratio{0.5};
+  Flag<"--sep", char>       separator{','};
+};
+
+constexpr ServerFlags kServerDefaults;  // in read-only data
+constinit ServerFlags server_flags;      // without dynamic initialization
+
+TEST(FlagsTest, ConstantInitializedDefaults) {
+  static_assert(kServerDefaults.port.value == 8080);
+  static_assert(kServerDefaults.ratio.value == 0.5);
+
+  const char* argv[]         = {"-p", "9090", "--verbose"};
+  auto [flags, args, errors] = ServerFlags::Parse(argv, kServerDefaults);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.port, Eq(9090));
+  ASSERT_TRUE(flags.verbose);
+  ASSERT_THAT(flags.ratio, Eq(0.5));
+  ASSERT_THAT(flags.separator, Eq(','));
+  ASSERT_THAT(kServerDefaults.port, Eq(8080));
+
+  std::tie(server_flags, args, errors) = ServerFlags::Parse(argv, server_flags);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(server_flags.port, Eq(9090));
+}
+
+TEST(FlagsTest, ValueConversions) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"-i", int>                 i;
+    Flag<"-u", unsigned char>       u;
+    Flag<"-d", double>              d;
+    Flag<"-s", std::string_view>    s;
+    Flag<"-b", std::optional<bool>> b;
+  };
+  {
+    const char* argv[] = {"-i", "12", "-u", "255", "-d", "1.5e3", "-s", "text", "-b", "true"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.i, Eq(12));
+    ASSERT_THAT(flags.u, Eq(255));
+    ASSERT_THAT(flags.d, Eq(1500.0));
+    ASSERT_THAT(flags.s.value.data(), Eq(argv[7]));
+    ASSERT_THAT(flags.b.value, Optional(true));
+  }
+  {  // a leading `+`, as accepted by `operator>>`
+    const char* argv[]         = {"-i", "+5", "-u", "+255", "-d", "+1.5"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.i, Eq(5));
+    ASSERT_THAT(flags.u, Eq(255));
+    ASSERT_THAT(flags.d, Eq(1.5));
+  }
+  {
+    const char* argv[]         = {"-i", "+-5", "-i", "++5", "-d", "+"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    using Error                = FlagInfo::Error;
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 0, .arg = "-i", .val = "+-5"},  //
+                                    Error{.pos = 2, .arg = "-i", .val = "++5"},  //
+                                    Error{.pos = 4, .arg = "-d", .val = "+"}));
+  }
+  {  // as rejected by `std::from_chars`, whether floating-point values use it or not
+    const char* argv[]         = {"-d", " 1.5", "-d", "0x1p3", "-d", "1e999", "-d", "1.5 "};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    using Error                = FlagInfo::Error;
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 0, .arg = "-d", .val = " 1.5"},   //
+                                    Error{.pos = 2, .arg = "-d", .val = "0x1p3"},  //
+                                    Error{.pos = 4, .arg = "-d", .val = "1e999"},  //
+                                    Error{.pos = 6, .arg = "-d", .val = "1.5 "}));
+  }
+  {
+    const char* argv[] = {"-i", "12abc", "-i", " 1", "-u", "256", "-d", "1.5.", "-b", "yes"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    using Error                = FlagInfo::Error;
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 0, .arg = "-i", .val = "12abc"},  //
+                                    Error{.pos = 2, .arg = "-i", .val = " 1"},     //
+                                    Error{.pos = 4, .arg = "-u", .val = "256"},    //
+                                    Error{.pos = 6, .arg = "-d", .val = "1.5."},   //
+                                    Error{.pos = 8, .arg = "-b", .val = "yes"}));
+  }
+}
+
+TEST(FlagsTest, ErrorsToString) {
+  FlagInfo::Errors errors;
+  errors.push_back({.pos = 1, .arg = "--a"});
+  errors.push_back({.pos = 2, .arg = "--b", .val = nullptr});
+  errors.push_back({.pos = 3, .arg = "--c", .val = R"(say "hi" \o/)"});
+  EXPECT_THAT(errors.ToString(), StrEq(R"(
+Unknown flag `--a` at index 1
+Missing value for flag `--b` at index 2
+Invalid value "say \"hi\" \\o/" for flag `--c` at index 3
+)"));
+}
+
+TEST(FlagsTest, TypeIntrospection) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"-i", int>                        i;
+    Flag<"-d", double>                     d;
+    Flag<"-s", std::string>                s;
+    Flag<"-v", std::vector<int>>           v;
+    Flag<"-o", std::optional<std::string>> o;
+    Flag<"-c", Point>                      c{0, 0};
+  };
+  using enum FlagInfo::Type::Kind;
+  const TestFlags                                                flags;
+  std::vector<std::pair<std::string_view, FlagInfo::Type::Kind>> types;
+  for (const auto* flag_info : flags.FlagInfos()) {
+    types.emplace_back(flag_info->type->name, flag_info->type->kind);
+  }
+  using testing::_;
+  using testing::Pair;
+  EXPECT_THAT(types, ElementsAre(Pair("int", kIntegral),    //
+                                 Pair("double", kFloating),  //
+                                 Pair(_, kString),           //
+                                 Pair(_, kVector),           //
+                                 Pair(_, kOptional),         //
+                                 Pair(testing::HasSubstr("Point"), kCustom)));
+  static_assert(kType<std::vector<int>>.name.starts_with("std::vector<int"));
+  static_assert([] {  // as spelled by MSVC
+    constexpr std::string_view     kName = "class std::vector<int,class std::allocator<int> >";
+    std::array<char, kName.size()> copy{};
+    const std::size_t              size = CopyTypeName(kName, copy.data());
+    return std::string_view(copy.data(), size) == "std::vector<int,std::allocator<int>>";
+  }());
+}
+
+TEST(FlagsTest, OutOfMemory) {
+  struct TestFlags : Flags<TestFlags, 1> {
+    Flag<"-n", int> count;
+  };
+  using Error = FlagInfo::Error;
+  {
+    const char* argv[] = {"a", "-n", "1", "b", "c"};
+    fail_nothrow_new   = true;
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    fail_nothrow_new           = false;
+    ASSERT_THAT(flags.count, Eq(1));
+    ASSERT_THAT(args, ElementsAre("a"));
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 3, .arg = "b", .val = Error::kNoMemory}));
+    ASSERT_TRUE(errors.lost);
+    ASSERT_THAT(errors.ToString(), StrEq(R"(
+Out of memory for argument `b` at index 3
+Out of memory for other errors
+)"));
+  }
+  {
+    TestFlags::Args   args;
+    TestFlags::Errors errors;
+    ASSERT_TRUE(args.push_back("a"));
+    ASSERT_TRUE(args.push_back("b"));
+    ASSERT_TRUE(args.push_back("-n"));
+    ASSERT_TRUE(args.push_back("2"));
+    fail_nothrow_new = true;
+    auto flags       = TestFlags::Parse(args, errors);
+    fail_nothrow_new = false;
+    ASSERT_THAT(flags.count, Eq(2));
+    ASSERT_THAT(args, ElementsAre("a"));
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 1, .arg = "b", .val = Error::kNoMemory}));
+    ASSERT_FALSE(errors.lost);
+  }
+  {  // a copy that can't allocate doesn't drop the errors silently
+    FlagInfo::Errors errors;
+    for (int pos = 0; pos <= static_cast<int>(FlagInfo::kInlineSize); ++pos) {
+      errors.Add({.pos = pos, .arg = "-x"});
+    }
+    FlagInfo::Errors assigned;
+    fail_nothrow_new            = true;
+    const FlagInfo::Errors copy = errors;
+    assigned                    = errors;
+    fail_nothrow_new            = false;
+    ASSERT_THAT(copy, IsEmpty());
+    ASSERT_TRUE(copy.lost);
+    ASSERT_TRUE(copy);
+    ASSERT_TRUE(assigned.lost);
+    ASSERT_FALSE(FlagInfo::Errors(errors).lost);
+  }
+}
+
+#if defined(__cpp_exceptions)
+struct Huge {};
+
+bool ParseValue(const char* /*unused*/, Huge& /*unused*/) {
+  throw std::bad_alloc();
+}
+
+Huge MakeHuge() {
+  throw std::bad_alloc();
+}
+
+TEST(FlagsTest, OutOfMemoryWhileParsingValue) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--huge", Huge>    huge;
+    Flag<"--default", Huge> by_default{Default<MakeHuge>{}};
+  };
+  const char* argv[]         = {"--huge", "1"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  using Error                = FlagInfo::Error;
+  const char* name           = flags.FlagInfos()[1]->name.data();
+  ASSERT_THAT(errors, ElementsAre(Error{.pos = 0, .arg = "--huge", .val = Error::kNoMemory},
+                                  Error{.pos = -1, .arg = name, .val = Error::kNoMemory}));
+  ASSERT_THAT(errors.ToString(), testing::HasSubstr(
+                                     "Out of memory for the default value of flag `--default`\n"));
+}
+#endif
+
+TEST(FlagsTest, InlineStorage) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"-n", int>  count;
+    Flag<"-v", bool> verbose;
+  };
+  struct SmallFlags : Flags<SmallFlags, 1> {
+    Flag<"-n", int> count;
+  };
+  struct HeapFlags : Flags<HeapFlags, 0> {
+    Flag<"-n", int> count;
+  };
+  const char* argv[] = {"cmd", "-n", "3", "a", "-v", "b", "c"};
+  {
+    allocations                = 0;
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(allocations, Eq(0));
+    ASSERT_THAT(args, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(errors, IsEmpty());
+
+    auto moved = std::move(args);
+    ASSERT_THAT(moved, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(args, IsEmpty());  // NOLINT(bugprone-use-after-move)
+  }
+  {
+    auto [flags, args, errors] = SmallFlags::Parse(argv);
+    ASSERT_THAT(args, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 4, .arg = "-v"}));
+
+    auto moved = std::move(args);
+    ASSERT_THAT(moved, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(args, IsEmpty());  // NOLINT(bugprone-use-after-move)
+  }
+  {
+    auto [flags, args, errors] = HeapFlags::Parse(argv);
+    ASSERT_THAT(args, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 4, .arg = "-v"}));
+
+    auto moved = std::move(args);
+    ASSERT_THAT(moved, ElementsAre("cmd", "a", "b", "c"));
+    ASSERT_THAT(args, IsEmpty());  // NOLINT(bugprone-use-after-move)
+    auto empty = std::move(args);  // NOLINT(bugprone-use-after-move)
+    ASSERT_THAT(empty, IsEmpty());
+  }
+}
+
+TEST(FlagsTest, RepeatedFlagsAreReserved) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"-s", std::vector<std::string>> strings;
+    Flag<"-n", int>                      count;
+  };
+  const char* argv[] = {"-s", "x", "-n", "2", "-s", "y", "a", "-s", "z", "--", "-s", "5"};
+  allocations                = 0;
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(allocations, Eq(1));
+  ASSERT_THAT(flags.strings.value, ElementsAre("x", "y", "z"));
+  ASSERT_THAT(flags.count, Eq(2));
+  ASSERT_THAT(args, ElementsAre("a", "-s", "5"));
+  ASSERT_THAT(errors, IsEmpty());
+}
+
+TEST(FlagsTest, MemoryResource) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"-s", std::pmr::vector<std::pmr::string>> strings;
+    Flag<"-p", std::pmr::string>                   path;
+    Flag<"-n", int>                                count;
+  };
+  std::array<std::byte, 4096>         buffer{};
+  std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size(),
+                                               std::pmr::null_memory_resource());
+
+  const char* argv[] = {"-s", "not a small string, to be allocated",   //
+                        "-p", "/a/path/long/enough/to/allocate",       //
+                        "-s", "another string, allocated as well",     //
+                        "-n", "3",                                     //
+                        "a",  "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+  allocations                = 0;
+  auto [flags, args, errors] = TestFlags::Parse(argv, &resource);
+  ASSERT_THAT(allocations, Eq(0));
+  ASSERT_THAT(flags.strings.value, ElementsAre("not a small string, to be allocated",
+                                               "another string, allocated as well"));
+  ASSERT_THAT(flags.path.value, StrEq("/a/path/long/enough/to/allocate"));
+  ASSERT_THAT(flags.count, Eq(3));
+  ASSERT_THAT(args, ElementsAre("a", "b", "c", "d", "e", "f", "g", "h", "i", "j"));
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.strings->get_allocator().resource(), Eq(&resource));
+  ASSERT_THAT(args.resource(), Eq(&resource));
+}
+
+TEST(FlagsTest, InternedStrings) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--tag", InternedStrings> tags;
+  };
+  StringPool pool;
+  TestFlags  defaults;
+  defaults.tags.value = InternedStrings(&pool);
+
+  std::vector<InternedStrings> lines;
+  for (std::string line : {"gpu", "cpu", "gpu"}) {  // values don't outlive a line
+    const char* argv[]         = {"--tag", line.c_str(), "--tag", "ssd"};
+    auto [flags, args, errors] = TestFlags::Parse(argv, defaults);
+    ASSERT_THAT(errors, IsEmpty());
+    lines.push_back(std::move(flags.tags.value));
+  }
+  ASSERT_THAT(lines, ElementsAre(ElementsAre("gpu", "ssd"), ElementsAre("cpu", "ssd"),
+                                 ElementsAre("gpu", "ssd")));
+  ASSERT_THAT(pool.size(), Eq(3U));
+  ASSERT_THAT(lines[0][0].data(), Eq(lines[2][0].data()));
+  ASSERT_THAT(lines[0][1].data(), Eq(lines[1][1].data()));
+
+  const char* argv[]         = {"--tag", "ssd"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);  // without a pool
+  ASSERT_THAT(flags.tags.value, ElementsAre("ssd"));
+  ASSERT_THAT(flags.tags.value[0].data(), Eq(argv[1]));
+}
+
+TEST(FlagsTest, EqualSyntax) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--offset", int, "-o">             offset;
+    Flag<"--name", std::string>             name;
+    Flag<"--tag", std::vector<std::string>> tags;
+    Flag<"--verbose", bool>                 verbose;
+  };
+  {
+    const char* argv[] = {"--offset=-3", "--name=", "--tag=a=b", "--tag", "c", "-o=4", "d"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.offset, Eq(4));
+    ASSERT_THAT(flags.name.value, StrEq(""));
+    ASSERT_THAT(flags.tags.value, ElementsAre("a=b", "c"));
+    ASSERT_THAT(args, ElementsAre("d"));
+  }
+  {
+    const char* argv[]         = {"a", "--offset=x", "--verbose=y", "--unknown=1", "--name", "-x"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(args, ElementsAre("a"));
+    using Error = FlagInfo::Error;
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 1, .arg = argv[1], .val = argv[1] + 9,  //
+                                          .flag = "--offset"},
+                                    Error{.pos = 2, .arg = argv[2], .val = argv[2] + 10,  //
+                                          .flag = "--verbose"},
+                                    Error{.pos = 3, .arg = argv[3]},
+                                    Error{.pos = 4, .arg = argv[4], .val = nullptr},
+                                    Error{.pos = 5, .arg = argv[5]}));
+    ASSERT_THAT(errors.ToString(), StrEq(R"(
+Invalid value "x" for flag `--offset` at index 1
+Invalid value "y" for flag `--verbose` at index 2
+Unknown flag `--unknown=1` at index 3
+Missing value for flag `--name` at index 4
+Unknown flag `-x` at index 5
+)"));
+  }
+}
+
+TEST(FlagsTest, ShortFlagClusters) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--verbose", bool, "-v"> verbose;
+    Flag<"-x", bool>              extract;
+    Flag<"--port", int, "-p">     port;
+    Flag<"-n", std::string>       name;
+  };
+  using Error = FlagInfo::Error;
+  {
+    const char* argv[]         = {"-vx", "-p8080", "-xn", "abc", "-xp=1", "-x"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors,
+                ElementsAre(Error{.pos = 4, .arg = argv[4], .val = argv[4] + 3, .flag = "-p"}));
+    ASSERT_TRUE(flags.verbose);
+    ASSERT_TRUE(flags.extract);
+    ASSERT_THAT(flags.port, Eq(8080));
+    ASSERT_THAT(flags.name.value, StrEq("abc"));
+  }
+  {
+    const char* argv[]         = {"-xz", "-vn"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(Error{.pos = 0, .arg = argv[0]},
+                                    Error{.pos = 1, .arg = argv[1], .val = nullptr, .flag = "-n"}));
+    ASSERT_FALSE(flags.extract);  // as `-z` is unknown
+    ASSERT_TRUE(flags.verbose);
+  }
+  {  // errors name the flag rather than the whole argument
+    const char* argv[]         = {"-pabc", "-xp", "x", "-vn"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors.ToString(), StrEq(R"(
+Invalid value "abc" for flag `-p` at index 0
+Invalid value "x" for flag `-p` at index 1
+Missing value for flag `-n` at index 3
+)"));
+  }
+}
+
+TEST(FlagsTest, PrefixFlags) {
+  struct TestFlags : Flags<TestFlags> {
+    PrefixFlag<"-I", std::vector<std::string_view>> includes;
+    PrefixFlag<"-D", std::vector<std::string_view>> defines;
+    PrefixFlag<"-Dx", std::vector<std::string_view>> defines_x;
+    PrefixFlag<"-O", int>                            optimize;
+    Flag<"-o", std::string>                          output;
+  };
+  const char* argv[] = {"-I/usr/include", "-I", "include", "-DNDEBUG", "-DLEVEL=2", "-Dxy",
+                        "-O2",            "-o", "a.out",   "-Ox",      "main.cc",   "-I=sys"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{
+                          .pos = 9, .arg = argv[9], .val = argv[9] + 2, .flag = "-O"}));
+  ASSERT_THAT(errors.ToString(), StrEq("\nInvalid value \"x\" for flag `-O` at index 9\n"));
+  ASSERT_THAT(flags.includes.value, ElementsAre("/usr/include", "include", "=sys"));
+  ASSERT_THAT(flags.includes->front().data(), Eq(argv[0] + 2));
+  ASSERT_THAT(flags.defines.value, ElementsAre("NDEBUG", "LEVEL=2"));
+  ASSERT_THAT(flags.defines_x.value, ElementsAre("y"));
+  ASSERT_THAT(flags.optimize, Eq(2));
+  ASSERT_THAT(flags.output.value, StrEq("a.out"));
+  ASSERT_THAT(args, ElementsAre("main.cc"));
+}
+
+TEST(FlagsTest, BoolValues) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--cache", bool>         cache{true};
+    Flag<"--verbose", bool, "-v"> verbose;
+    Flag<"-x", bool>              extract{true};
+    Flag<"--no-op", bool>         no_op;
+  };
+  {
+    const char* argv[]         = {"--no-cache", "--verbose=true", "--no-op", "1"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_FALSE(flags.cache);
+    ASSERT_TRUE(flags.verbose);
+    ASSERT_TRUE(flags.no_op);
+    ASSERT_THAT(args, ElementsAre("1"));  // not a value, as not attached by `=`
+  }
+  {
+    const char* argv[]         = {"--cache", "--no-cache", "--verbose=false", "-x=0", "--no-x"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 4, .arg = argv[4]}));
+    ASSERT_FALSE(flags.cache);  // the last one wins
+    ASSERT_FALSE(flags.verbose);
+    ASSERT_FALSE(flags.extract);
+  }
+}
+
+TEST(FlagsTest, CountFlags) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--verbose", Count, "-v"> verbosity;
+    Flag<"-x", bool>               extract;
+  };
+  {
+    const char* argv[]         = {"-vxv", "--verbose", "-v", "a", "-vv"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.verbosity.value, Eq(6));
+    ASSERT_TRUE(flags.extract);
+    ASSERT_THAT(args, ElementsAre("a"));
+  }
+  {
+    const char* argv[]         = {"-vvv", "--no-verbose", "-v"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(flags.verbosity.value, Eq(1));
+  }
+  {
+    const char* argv[]         = {"--verbose=254", "-vvv", "--verbose=256"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors,
+                ElementsAre(FlagInfo::Error{
+                    .pos = 2, .arg = argv[2], .val = argv[2] + 10, .flag = "--verbose"}));
+    ASSERT_THAT(flags.verbosity.value, Eq(255));
+  }
+  static_assert(sizeof(Count) == 1);
+}
+
+TEST(FlagsTest, MoreAliases) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--output", std::string, "-o", "--out", "--output-file"> output;
+    Flag<"--verbose", Count, "-v", "--verbosity", "-V">           verbosity;
+    Flag<"--tag", std::vector<std::string>, "-t", "--label">      tags;
+  };
+  {
+    const char* argv[] = {"--output-file", "a", "-Vv", "--verbosity", "--label=x", "-t", "y"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.output.value, StrEq("a"));
+    ASSERT_THAT(flags.verbosity.value, Eq(3));
+    ASSERT_THAT(flags.tags.value, ElementsAre("x", "y"));
+  }
+  {
+    const char* argv[]         = {"--out=b", "-V", "--no-verbosity"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.output.value, StrEq("b"));
+    ASSERT_THAT(flags.verbosity.value, Eq(0));
+  }
+  struct RenamedFlags : Flags<RenamedFlags> {  // more names than fit in the table of names
+    Flag<"--color", bool, "-c", "--colour", "--colors", "--colours"> color;
+  };
+  {
+    const char* argv[]         = {"--colours", "--no-colour", "--colors"};
+    auto [flags, args, errors] = RenamedFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_TRUE(flags.color);
+    ASSERT_THAT(args, IsEmpty());
+  }
+  const TestFlags flags;
+  ASSERT_THAT(flags.FlagInfos()[0]->alias, StrEq("-o"));
+  ASSERT_THAT(flags.FlagInfos()[0]->aliases, ElementsAre("--out", "--output-file"));
+}
+
+// A type with bounds like `NArgs`, but a single value.
+struct Level {
+  static constexpr int kMin = 0;
+  static constexpr int kMax = 3;
+
+  int value = kMin;
+};
+
+bool ParseValue(const char* arg, Level& level) {
+  return xdk::ParseValue(arg, level.value) && Level::kMin <= level.value &&
+         level.value <= Level::kMax;
+}
+
+TEST(FlagsTest, FlagWithBounds) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--level", Level> level;
+  };
+  const char* argv[]         = {"--level", "2", "a"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.level->value, Eq(2));
+  ASSERT_THAT(args, ElementsAre("a"));
+  ASSERT_THAT(flags.FlagInfos()[0]->max_values, Eq(1));
+}
+
+TEST(FlagsTest, NArgsFlags) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--ids", NArgs<int>, "-i">                ids;
+    Flag<"--pair", NArgs<std::string, 2, 2>>       pair;
+    Flag<"--names", NArgs<std::string_view, 0, 3>> names;
+    Flag<"-x", bool>                               extract;
+  };
+  {
+    const char* argv[]         = {"--ids", "1", "2", "3", "-x", "a", "-i", "4", "--", "5"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.ids.value, ElementsAre(1, 2, 3, 4));
+    ASSERT_TRUE(flags.extract);
+    ASSERT_THAT(args, ElementsAre("a", "5"));
+  }
+  {
+    const char* argv[]         = {"--names", "a", "b", "c", "d", "--names", "--ids=7", "8"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.names.value, ElementsAre("a", "b", "c"));
+    ASSERT_THAT(flags.ids.value, ElementsAre(7));
+    ASSERT_THAT(args, ElementsAre("d", "8"));
+  }
+  {
+    const char* argv[]         = {"--pair", "a", "--ids", "1", "x", "--ids"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 0, .arg = argv[0], .val = nullptr},
+                                    FlagInfo::Error{.pos = 2, .arg = argv[2], .val = argv[4]},
+                                    FlagInfo::Error{.pos = 5, .arg = argv[5], .val = nullptr}));
+    ASSERT_THAT(flags.pair.value, ElementsAre("a"));
+    ASSERT_THAT(args, IsEmpty());
+  }
+  {
+    const char* argv[] = {"--ids", "-1", "2", "-xi", "-3", "--names", "-", "--names=-a", "-b"};
+    auto [flags, args, errors] = TestFlags::Parse(argv, false);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.ids.value, ElementsAre(-1, 2, -3));
+    ASSERT_TRUE(flags.extract);
+    ASSERT_THAT(flags.names.value, ElementsAre("-", "-a"));
+    ASSERT_THAT(args, ElementsAre("-b"));
+  }
+}
+
+TEST(FlagsTest, PositionalMembers) {
+  struct TestFlags : Flags<TestFlags> {
+    Positional<"in", std::string> source;
+    Positional<"count", int>      count{1};
+    Flag<"-x", bool>              extract;
+    Rest<std::string_view>        rest;
+  };
+  {
+    const char* argv[]         = {"a", "-x", "3", "b", "c", "--", "-d"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.source.value, StrEq("a"));
+    ASSERT_THAT(flags.count.value, Eq(3));
+    ASSERT_TRUE(flags.extract);
+    ASSERT_THAT(flags.rest.value, ElementsAre("b", "c", "-d"));
+    ASSERT_THAT(args, IsEmpty());
+  }
+  {
+    const char* argv[]         = {"a", "b", "-n"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 1, .arg = argv[1], .val = argv[1]},
+                                    FlagInfo::Error{.pos = 2, .arg = argv[2]}));
+    ASSERT_THAT(errors.ToString(), testing::HasSubstr("Invalid argument `b` at index 1"));
+    ASSERT_THAT(flags.count.value, Eq(1));
+  }
+  {  // negative numbers are values, as for `NArgs`, but not unknown flags
+    const char* argv[]         = {"a", "-3", "-.5", "-y"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 3, .arg = argv[3]}));
+    ASSERT_THAT(flags.count.value, Eq(-3));
+    ASSERT_THAT(flags.rest.value, ElementsAre("-.5"));
+  }
+  {
+    struct TwoFlags : Flags<TwoFlags> {
+      Positional<"in", std::string_view> source;
+      Flag<"-x", bool>                   extract;
+    };
+    const char* argv[]         = {"in", "a", "-x", "b"};
+    auto [flags, args, errors] = TwoFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.source.value, StrEq("in"));
+    ASSERT_THAT(args, ElementsAre("a", "b"));
+  }
+  {
+    struct LateFlags : Flags<LateFlags> {
+      Rest<std::string_view>             rest;
+      Positional<"in", std::string_view> source;
+    };
+    const char* argv[]         = {"a", "b"};
+    auto [flags, args, errors] = LateFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = -1,
+                                                    .arg = flags.FlagInfos()[1]->name.data(),
+                                                    .val = FlagInfo::Error::kMisplaced}));
+    ASSERT_THAT(errors.ToString(), testing::HasSubstr("Positional member `in` is declared after"));
+    ASSERT_THAT(flags.rest.value, ElementsAre("a", "b"));
+  }
+}
+
+TEST(FlagsTest, ParseInPlace) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--port", int, "-p"> port;
+    Flag<"-x", bool>          extract;
+  };
+  std::array<std::string, 7> strings = {"prog", "-p", "80", "a", "--other", "-x", "b"};
+  std::array<char*, 8>       argv{};
+  for (std::size_t i = 0; i < strings.size(); ++i) argv[i] = strings[i].data();
+  int argc = static_cast<int>(strings.size());
+
+  allocations          = 0;
+  auto [flags, errors] = TestFlags::ParseInPlace(argc, argv.data(), false);
+  ASSERT_THAT(allocations, Eq(0));
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.port.value, Eq(80));
+  ASSERT_TRUE(flags.extract);
+  ASSERT_THAT(argc, Eq(4));
+  ASSERT_THAT(std::vector<std::string_view>(argv.begin(), argv.begin() + argc),
+              ElementsAre("prog", "a", "--other", "b"));
+  ASSERT_THAT(argv[argc], testing::IsNull());
+
+  struct PositionalFlags : Flags<PositionalFlags> {  // the program name is not the input
+    Flag<"--port", int, "-p">             port;
+    Positional<"input", std::string_view> input;
+  };
+  std::array<std::string, 5> more = {"prog", "in.txt", "-p", "x", "b"};
+  for (std::size_t i = 0; i < more.size(); ++i) argv[i] = more[i].data();
+  argc                     = static_cast<int>(more.size());
+  auto [positional, error] = PositionalFlags::ParseInPlace(argc, argv.data(), false);
+  ASSERT_THAT(positional.input.value, StrEq("in.txt"));
+  ASSERT_THAT(error, ElementsAre(FlagInfo::Error{.pos = 2, .arg = more[2].data(),
+                                                 .val = more[3].data()}));
+  ASSERT_THAT(std::vector<std::string_view>(argv.begin(), argv.begin() + argc),
+              ElementsAre("prog", "b"));
+  ASSERT_THAT(argv[argc], testing::IsNull());
+}
+
+template <typename F, typename M>
+concept HasIsSet = requires(const F& flags, M F::*member) { flags.IsSet(member); };
+
+TEST(FlagsTest, SetFlags) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--port", int, "-p">   port{80};
+    Flag<"--host", std::string> host{"localhost"};
+    Flag<"-x", bool>            extract;
+    Flag<"-v", bool>            verbose;
+    Positional<"in", int>       in;
+  };
+  const char* argv[]         = {"-p", "80", "-xv", "1"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_TRUE(flags.IsSet(&TestFlags::port));
+  ASSERT_FALSE(flags.IsSet(&TestFlags::host));
+  ASSERT_TRUE(flags.IsSet(&TestFlags::extract));
+  ASSERT_TRUE(flags.IsSet(&TestFlags::verbose));
+  ASSERT_TRUE(flags.IsSet(&TestFlags::in));
+  std::vector<std::string_view> names;
+  flags.ForEachSet([&](const FlagInfo& info) { names.push_back(info.name); });
+  ASSERT_THAT(names, ElementsAre("--port", "-x", "-v", "in"));
+  ASSERT_FALSE(TestFlags().IsSet(&TestFlags::port));
+  static_assert(HasIsSet<TestFlags, decltype(TestFlags::port)>);
+  static_assert(!HasIsSet<TestFlags, int>);
+}
+
+TEST(FlagsTest, Constraints) {
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--port", int, "-p">          port{Range<1, 65535>{}, 8080};
+    Flag<"--ids", std::vector<int>>    ids{Range<0, 9>{}};
+    Flag<"--ratio", double>            ratio{Range<0.0, 1.0>{}, Required{}};
+    Flag<"--json", bool>               json{ExclusiveGroup<1>{}};
+    Flag<"--xml", bool>                xml{ExclusiveGroup<1>{}};
+    Flag<"--csv", bool>                csv{ExclusiveGroup<1>{}};
+    Flag<"--name", std::string, "-n">  name{Required{}, ExclusiveGroup<2>{}, "a"};
+    Flag<"--id", std::optional<short>> id{ExclusiveGroup<2>{}, Range<1, 99>{}};
+  };
+  const TestFlags          defaults;
+  std::vector<const char*> names;
+  for (const FlagInfo* info : defaults.FlagInfos()) names.push_back(info->name.data());
+  const char* const kRequired = FlagInfo::Error::kRequired;
+  {
+    const char* argv[]         = {"--ratio", "0.5", "--ids", "3", "--csv", "-n", "b"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_THAT(flags.port.value, Eq(8080));
+    ASSERT_THAT(flags.ids.value, ElementsAre(3));
+    ASSERT_THAT(flags.name.value, StrEq("b"));
+  }
+  {
+    const char* argv[] = {"-p", "0", "--ids", "10", "--xml", "--json", "--id", "100", "--id=7"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors,
+                ElementsAre(FlagInfo::Error{.pos = 0, .arg = argv[0], .val = argv[1]},
+                            FlagInfo::Error{.pos = 2, .arg = argv[2], .val = argv[3]},
+                            FlagInfo::Error{.pos = 6, .arg = argv[6], .val = argv[7]},
+                            FlagInfo::Error{.pos = -1, .arg = names[2], .val = kRequired},
+                            FlagInfo::Error{.pos = -1, .arg = names[4], .val = names[3]},
+                            FlagInfo::Error{.pos = -1, .arg = names[6], .val = kRequired}));
+    ASSERT_THAT(flags.id.value, Optional(Eq(7)));
+    ASSERT_THAT(errors.ToString(), testing::HasSubstr("Missing required flag `--ratio`\n"
+                                                      "Flag `--xml` conflicts with `--json`\n"));
+  }
+  {
+    const char* argv[]         = {"--ratio=1", "--name", "c", "--id", "1"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = -1, .arg = names[7], .val = names[6]}));
+  }
+  {  // flags without a value only conflict if left true, so that they can be overridden
+    const char* argv[]         = {"--ratio=1", "--no-json", "--xml", "-n", "b"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+  }
+  {
+    const char* argv[]         = {"--ratio=1", "--json", "--no-json", "--xml", "-n", "b"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_FALSE(flags.json.value);
+  }
+  {
+    const char* argv[]         = {"--ratio=1", "--json=false", "--xml", "-n", "b"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+  }
+  {  // only the flags of the command line being parsed count, not of the defaults
+    const char* argv[]            = {"--ratio=1", "--json", "-n", "b"};
+    auto [defaults, args, errors] = TestFlags::Parse(argv);
+    const char* more[]            = {"--ratio=1", "--xml", "-n", "b"};
+    auto [flags, more_args, more_errors] = TestFlags::Parse(more, std::move(defaults));
+    ASSERT_THAT(more_errors, IsEmpty());
+    ASSERT_TRUE(flags.IsSet(&TestFlags::json));
+  }
+  struct UnsignedFlags : Flags<UnsignedFlags> {  // bounds compared by value, not converted
+    Flag<"--jobs", unsigned> jobs{Range<-1, 5>{}};
+  };
+  {
+    const char* argv[]         = {"--jobs", "6", "--jobs", "3"};
+    auto [flags, args, errors] = UnsignedFlags::Parse(argv);
+    ASSERT_THAT(errors, ElementsAre(FlagInfo::Error{.pos = 0, .arg = argv[0], .val = argv[1]}));
+    ASSERT_THAT(flags.jobs.value, Eq(3U));
+  }
+}
+
+enum class Mode { kFast, kSafe, kDebug };
+
+TEST(FlagsTest, EnumFlags) {
+  using ModeEnum = Enum<Mode, Choice<"fast", Mode::kFast>, Choice<"safe", Mode::kSafe>,
+                        Choice<"debug", Mode::kDebug>>;
+  static_assert(*ModeEnum::Find("debug") == Mode::kDebug);
+  static_assert(ModeEnum::Find("deb") == nullptr);
+  // Names differing only in a high bit of one character, e.g. in case.
+  using CaseEnum = Enum<int, Choice<"on", 1>, Choice<"ON", 2>, Choice<"h", 3>, Choice<"p", 4>>;
+  static_assert(*CaseEnum::Find("on") == 1 && *CaseEnum::Find("ON") == 2);
+  static_assert(*CaseEnum::Find("h") == 3 && *CaseEnum::Find("p") == 4);
+  static_assert(CaseEnum::Find("On") == nullptr);
+  using DigitEnum = Enum<int, Choice<"v1", 1>, Choice<"v9", 9>>;
+  static_assert(*DigitEnum::Find("v1") == 1 && *DigitEnum::Find("v9") == 9);
+  static_assert(DigitEnum::Find("v5") == nullptr);
+
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--mode", ModeEnum>                                        mode{Mode::kSafe};
+    Flag<"--modes", std::vector<ModeEnum>>                          modes;
+    Flag<"--level", Enum<int, Choice<"low", 1>, Choice<"high", 9>>> level;
+  };
+  {
+    const char* argv[]         = {"--mode", "fast", "--modes=debug", "--modes", "safe"};
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(errors, IsEmpty());
+    ASSERT_TRUE(flags.mode == Mode::kFast);
+    ASSERT_THAT(flags.modes.value, ElementsAre(Mode::kDebug, Mode::kSafe));
+    ASSERT_THAT(flags.level.value.value, Eq(1));
+  }
+  {
+    const char* argv[]         = {"--level", "high", "--mode", "slow"};
+    allocations                = 0;
+    auto [flags, args, errors] = TestFlags::Parse(argv);
+    ASSERT_THAT(allocations, Eq(0));
+    ASSERT_THAT(flags.level.value.value, Eq(9));
+    ASSERT_TRUE(flags.mode == Mode::kSafe);
+    ASSERT_THAT(errors.ToString(), StrEq("\nInvalid value \"slow\" for flag `--mode` at index 2, "
+                                         "expected one of: fast safe debug\n"));
+  }
+  {
+    struct WrappedFlags : Flags<WrappedFlags> {
+      Flag<"--modes", std::vector<ModeEnum>>   modes;
+      Flag<"--all", NArgs<ModeEnum>>           all;
+      Flag<"--maybe", std::optional<ModeEnum>> maybe;
+    };
+    const char* argv[]         = {"--modes", "a", "--all", "fast", "b", "--maybe", "c"};
+    auto [flags, args, errors] = WrappedFlags::Parse(argv);
+    ASSERT_THAT(errors.ToString(), StrEq(R"(
+Invalid value "a" for flag `--modes` at index 0, expected one of: fast safe debug
+Invalid value "b" for flag `--all` at index 2, expected one of: fast safe debug
+Invalid value "c" for flag `--maybe` at index 5, expected one of: fast safe debug
+)"));
+  }
+}
+
+TEST(FlagsTest, DurationsAndByteSizes) {
+  using std::chrono::duration;
+  using std::chrono::milliseconds;
+  using std::chrono::seconds;
+  const auto parse = [](const char* arg, auto value) -> std::optional<decltype(value)> {
+    if (!xdk::ParseValue(arg, value)) return std::nullopt;
+    return value;
+  };
+  ASSERT_THAT(parse("250ms", milliseconds()), Optional(milliseconds(250)));
+  ASSERT_THAT(parse("2000us", milliseconds()), Optional(milliseconds(2)));
+  ASSERT_THAT(parse("2min", milliseconds()), Optional(milliseconds(120'000)));
+  ASSERT_THAT(parse("-3h", seconds()), Optional(seconds(-10'800)));
+  ASSERT_THAT(parse("1d", seconds()), Optional(seconds(86'400)));
+  ASSERT_THAT(parse("0", seconds()), Optional(seconds(0)));
+  ASSERT_THAT(parse("+5ms", milliseconds()), Optional(milliseconds(5)));
+  ASSERT_THAT(parse("250ms", duration<double>()), Optional(duration<double>(0.25)));
+  ASSERT_THAT(parse("1500us", milliseconds()), Eq(std::nullopt));  // not whole
+  ASSERT_THAT(parse("10", seconds()), Eq(std::nullopt));           // no unit
+  ASSERT_THAT(parse("10 s", seconds()), Eq(std::nullopt));
+  ASSERT_THAT(parse("10sec", seconds()), Eq(std::nullopt));
+  // Overflows
+  ASSERT_THAT(parse("200000d", std::chrono::nanoseconds()), Eq(std::nullopt));
+  ASSERT_THAT(parse("200s", duration<std::int8_t>()), Eq(std::nullopt));
+  ASSERT_THAT(parse("3h", duration<std::int8_t, std::ratio<60>>()), Eq(std::nullopt));
+  ASSERT_THAT(parse("1e308d", duration<double>()), Eq(std::nullopt));
+  ASSERT_THAT(parse("1e36h", duration<float>()), Eq(std::nullopt));
+  ASSERT_THAT(parse("infs", duration<double>()), Eq(std::nullopt));
+  ASSERT_THAT(parse("nans", duration<double>()), Eq(std::nullopt));
+
+  ASSERT_THAT(parse("4096", ByteSize())->value, Eq(4096U));
+  ASSERT_THAT(parse("12B", ByteSize())->value, Eq(12U));
+  ASSERT_THAT(parse("+12B", ByteSize())->value, Eq(12U));
+  ASSERT_THAT(parse("4kB", ByteSize())->value, Eq(4'000U));
+  ASSERT_THAT(parse("4KiB", ByteSize())->value, Eq(4'096U));
+  ASSERT_THAT(parse("3GB", ByteSize())->value, Eq(3'000'000'000U));
+  ASSERT_THAT(parse("4GiB", ByteSize())->value, Eq(std::uint64_t{4} << 30));
+  ASSERT_THAT(parse("15EiB", ByteSize())->value, Eq(std::uint64_t{15} << 60));
+  ASSERT_THAT(parse("16EiB", ByteSize()), Eq(std::nullopt));  // overflow
+  ASSERT_THAT(parse("4G", ByteSize()), Eq(std::nullopt));
+  ASSERT_THAT(parse("4Gb", ByteSize()), Eq(std::nullopt));
+  ASSERT_THAT(parse("4BB", ByteSize()), Eq(std::nullopt));
+  ASSERT_THAT(parse("-4B", ByteSize()), Eq(std::nullopt));
+
+  struct TestFlags : Flags<TestFlags> {
+    Flag<"--timeout", milliseconds>              timeout{1'000};
+    Flag<"--cache_size", ByteSize>               cache_size;
+    Flag<"--delays", std::vector<milliseconds>> delays;
+  };
+  const char* argv[]         = {"--timeout", "250ms", "--cache_size=4GiB", "--delays", "1s"};
+  auto [flags, args, errors] = TestFlags::Parse(argv);
+  ASSERT_THAT(errors, IsEmpty());
+  ASSERT_THAT(flags.timeout.value, Eq(milliseconds(250)));
+  ASSERT_THAT(flags.cache_size.value.value, Eq(std::uint64_t{4} << 30));
+  ASSERT_THAT(flags.delays.value, ElementsAre(milliseconds(1'000)));
+}
+
 }  // namespace
 }  // namespace xdk